@@ -27,6 +27,7 @@ using parsedArgs_t = std::unique_ptr<constParsedArg_t []>;
 
 #define ARG_REPEATABLE	1
 #define ARG_INCOMPLETE	2
+#define ARG_OPTIONAL	4
 
 void registerArgs(const arg_t *allowedArgs) noexcept;
 parsedArgs_t parseArguments(const uint32_t argc, const char *const *const argv) noexcept;
@@ -1,108 +1,112 @@
 #include <stdint.h>
 #include <memory.h>
-#include <math.h>
-#include <fenv.h>
 #include <new>
 #include <thread>
 #include "mandelbrot.hxx"
 #include "shade.hxx"
 #include "memBuffer.hxx"
 #include "memory.hxx"
+#include "escapeCodec.hxx"
 
-constexpr double power(double base, uint32_t exp) noexcept
-	{ return exp == 0 ? 1 : base * power(base, exp - 1); }
+// Samples are either shaded here or kept as escape values for the shader process to shade.
+template<typename T> T sampleFor(const double iteration) noexcept;
+template<> rgb8_t sampleFor(const double iteration) noexcept { return shade(iteration); }
+template<> uint32_t sampleFor(const double iteration) noexcept { return quantise(iteration); }
 
-constexpr static const double bailout = power(power(2, 8), 2);
-static const double log_2 = log(2);
-
-double computePoint(const point2_t p0) noexcept
-{
-	point2_t pp, p{};
-	uint16_t iteration{0};
-
-	for (; iteration < maxIterations; ++iteration)
-	{
-		pp = p * p;
-		if (pp.sum() > bailout)
-			break;
-		p.y(2 * p.mul() + p0.y());
-		p.x(pp.diff() + p0.x());
-	}
-
-	if (iteration < maxIterations && iteration)
-	{
-		pp = p * p;
-		const double zn = log(pp.sum()) / 2;
-		const double nu = log(zn / log_2) / log_2;
-		feclearexcept(FE_ALL_EXCEPT);
-		return iteration + 1 - nu;
-	}
-
-	return iteration;
-}
-
-void computeSubchunk(const area_t &size, const area_t &offset, const point2_t &scale,
-	const point2_t &origin, memBuffer_t<rgb8_t> &buffer) noexcept
+template<typename T> void computeSubchunk(const renderRequest_t &request, const tile_t &tile,
+	const point2_t &scale, const point2_t *const origins, const area_t subpixel, const int64_t axis,
+	memBuffer_t<T> *const subpixels) noexcept
 {
 	puts("Subpixel worker launched");
-	const uint32_t maxY = height - 1;
+	const area_t &size = tile.size;
+	const area_t &offset = tile.offset;
+	const uint32_t subdiv = request.subdiv;
+	const uint32_t imageHeight = request.size.height();
+	const double bailout = request.bailout * request.bailout;
+	memBuffer_t<T> &buffer = subpixels[subpixel.width() + (subpixel.height() * subdiv)];
+	const uint32_t maxY = imageHeight - 1;
 	for (uint32_t y{0}; y < size.height(); ++y)
 	{
+		// Rows below the axis take their mirror's samples - copied if it's in this chunk, as it is above us
+		// and so computed first, else computed at the mirror so they match a render where it is.
+		const int64_t sample = (int64_t(maxY - (offset.height() + y)) * subdiv) + subpixel.height();
+		const int64_t mirror = axis - sample;
+		uint32_t sourceY = offset.height() + y;
+		uint32_t sourceRow = subpixel.height();
+		if (mirror > sample && mirror < int64_t(imageHeight) * subdiv)
+		{
+			const uint32_t mirrorY = maxY - uint32_t(mirror / subdiv);
+			if (mirrorY >= offset.height() && mirrorY - offset.height() < size.height())
+			{
+				const auto &source = subpixels[subpixel.width() + (uint32_t(mirror % subdiv) * subdiv)];
+				const uint32_t mirrorOffset = (mirrorY - offset.height()) * size.width();
+				for (uint32_t x{0}; x < size.width(); ++x)
+					buffer.write(source.read(mirrorOffset + x));
+				continue;
+			}
+			sourceY = mirrorY;
+			sourceRow = uint32_t(mirror % subdiv);
+		}
+
+		const point2_t &origin = origins[subpixel.width() + (sourceRow * subdiv)];
 		for (uint32_t x{0}; x < size.width(); ++x)
 		{
-			area_t pixel = offset + area_t{x, y};
-			pixel.height(maxY - pixel.height());
-			const double iteration = computePoint((pixel / scale) + origin);
-			buffer.write(shade(iteration));
+			const area_t pixel{offset.width() + x, maxY - sourceY};
+			const double iteration = computePoint((pixel / scale) + origin, request.maxIterations, bailout);
+			buffer.write(sampleFor<T>(iteration));
 		}
 	}
 	puts("Subpixel worker done");
 }
 
-void computeChunk(const area_t size, const area_t offset, const point2_t scale,
-	const point2_t center, const uint32_t subdiv, stream_t &stream) noexcept try
+// Runs a worker per subpixel and hands each row of the chunk's samples to emitRow as it's ready.
+template<typename T, typename F> void computeSamples(const renderRequest_t &request, const tile_t tile, F emitRow)
 {
-	const point2_t origin = -((area_t{width, height} / scale) / 2) + center;
+	const uint32_t subdiv = request.subdiv;
+	const point2_t scale = renderScale(request);
+	const point2_t origin = renderOrigin(request, scale);
 	const point2_t subpixelOrigin = -(point2_t{double(subdiv / 2), double(subdiv / 2)} / subdiv) / scale;
 	const point2_t subpixelOffset = (point2_t{1, 1} / subdiv) / scale;
 	const uint32_t totalSubdivs = subdiv * subdiv;
-	memBuffer_t<rgb8_t>::length = width * height;
-	auto subpixels = makeUnique<memBuffer_t<rgb8_t> []>(totalSubdivs);
+	const int64_t axis = mirrorAxis(request);
+	// Each subpixel's buffer only ever holds the tile's samples.
+	memBuffer_t<T>::length = tile.size.width() * tile.size.height();
+	auto subpixels = makeUnique<memBuffer_t<T> []>(totalSubdivs);
 	auto subchunkThreads = makeUnique<std::thread []>(totalSubdivs);
-	if (!subpixels || !subchunkThreads)
+	// Where each subpixel's grid starts - any of which a worker may need to compute a row's mirror.
+	fixedVector_t<point2_t> origins{totalSubdivs};
+	if (!subpixels || !subchunkThreads || !origins.valid())
 		abort();
+	for (uint32_t y{0}; y < subdiv; ++y)
+	{
+		for (uint32_t x{0}; x < subdiv; ++x)
+			origins[x + (y * subdiv)] = origin + ((subpixelOffset * area_t{x, y}) + subpixelOrigin);
+	}
 
+	if (axis)
+		puts("View is symmetric about the real axis, mirroring rows about it");
 	printf("Launching %u subpixel workers\n", totalSubdivs);
 	for (uint32_t y{0}; y < subdiv; ++y)
 	{
 		for (uint32_t x{0}; x < subdiv; ++x)
 		{
-			const point2_t subchunkOffset = (subpixelOffset * area_t{x, y}) + subpixelOrigin;
 			const uint32_t index = x + (y * subdiv);
-			subchunkThreads[index] = std::thread([&](const point2_t origin, const uint32_t index) noexcept
+			subchunkThreads[index] = std::thread([&](const area_t subpixel, const uint32_t index) noexcept
 				{
 					threadAffinity(index);
-					computeSubchunk(size, offset, scale, origin, subpixels[index]);
-				}, origin + subchunkOffset, index
+					computeSubchunk(request, tile, scale, origins.data(), subpixel, axis, subpixels.get());
+				}, area_t{x, y}, index
 			);
 		}
 	}
 
-	fixedVector_t<rgb8_t> points{totalSubdivs};
-	if (!points.valid())
-		throw std::bad_alloc{};
-	for (uint32_t y{0}; y < size.height(); ++y)
+	for (uint32_t y{0}; y < tile.size.height(); ++y)
 	{
-		for (uint32_t x{0}; x < size.width(); ++x)
+		if (!emitRow(subpixels.get()))
 		{
-			for (uint32_t i{0}; i < totalSubdivs; ++i)
-				points[i] = subpixels[i].readNext();
-			if (!write(stream, shadePixel(points)))
-			{
-				printf("Aborting at %u, %u - %s\n", x, y, strerror(errno));
-				fflush(stdout);
-				abort();
-			}
+			printf("Aborting at row %u - %s\n", y, strerror(errno));
+			fflush(stdout);
+			abort();
 		}
 	}
 
@@ -110,4 +114,53 @@ void computeChunk(const area_t size, const area_t offset, const point2_t scale,
 	for (uint32_t i{0}; i < totalSubdivs; ++i)
 		subchunkThreads[i].join();
 }
+
+void computeChunk(const renderRequest_t &request, const tile_t tile, const bool values, stream_t &stream) noexcept try
+{
+	const area_t size = tile.size;
+	const uint32_t subdiv = request.subdiv;
+	const uint32_t totalSubdivs = subdiv * subdiv;
+	if (!values)
+	{
+		fixedVector_t<rgb8_t> points{totalSubdivs};
+		if (!points.valid())
+			throw std::bad_alloc{};
+		computeSamples<rgb8_t>(request, tile, [&](memBuffer_t<rgb8_t> *const subpixels) noexcept
+		{
+			for (uint32_t x{0}; x < size.width(); ++x)
+			{
+				for (uint32_t i{0}; i < totalSubdivs; ++i)
+					points[i] = subpixels[i].readNext();
+				if (!write(stream, shadePixel(points)))
+					return false;
+			}
+			return true;
+		});
+		return;
+	}
+
+	// Each row goes out as its encoded length followed by the encoded values, in a single write.
+	escapeCodec_t codec{size.width(), subdiv};
+	fixedVector_t<uint32_t> row{size_t(size.width()) * totalSubdivs};
+	fixedVector_t<uint8_t> packet{sizeof(uint32_t) + codec.maxLength()};
+	if (!codec.valid() || !row.valid() || !packet.valid())
+		throw std::bad_alloc{};
+	size_t sent{0};
+	computeSamples<uint32_t>(request, tile, [&](memBuffer_t<uint32_t> *const subpixels) noexcept
+	{
+		uint32_t *const values = row.data();
+		for (uint32_t x{0}; x < size.width(); ++x)
+		{
+			for (uint32_t i{0}; i < totalSubdivs; ++i)
+				values[(x * totalSubdivs) + i] = subpixels[i].readNext();
+		}
+		const uint32_t length = codec.encode(values, packet.data() + sizeof(uint32_t));
+		memcpy(packet.data(), &length, sizeof(uint32_t));
+		sent += sizeof(uint32_t) + length;
+		return stream.write(packet.data(), sizeof(uint32_t) + length);
+	});
+	if (size.width() && size.height())
+		printf("Sent %zu bytes of escape values, %.2f bytes per pixel\n", sent,
+			double(sent) / (size_t(size.width()) * size.height()));
+}
 catch (const std::bad_alloc &) { abort(); }
@@ -0,0 +1,240 @@
+#include <algorithm>
+#include "escapeCodec.hxx"
+
+// Residuals needing more than this many bits of unary prefix are sent in full instead.
+constexpr static const uint32_t unaryLimit = 16;
+// How many residuals the adaptation remembers before halving its history.
+constexpr static const uint32_t adaptWindow = 64;
+
+// Maps residuals of either sign onto the naturals, small magnitudes first.
+inline uint32_t zigzag(const int32_t value) noexcept
+	{ return (uint32_t(value) << 1) ^ uint32_t(value >> 31); }
+inline int32_t unzigzag(const uint32_t value) noexcept
+	{ return int32_t(value >> 1) ^ -int32_t(value & 1); }
+
+struct bitWriter_t final
+{
+private:
+	uint8_t *const data;
+	size_t length;
+	uint64_t bits;
+	uint32_t count;
+
+public:
+	bitWriter_t(uint8_t *const _data) noexcept : data{_data}, length{0}, bits{0}, count{0} { }
+
+	void write(const uint32_t value, const uint32_t width) noexcept
+	{
+		bits |= uint64_t(value) << count;
+		count += width;
+		for (; count >= 8; count -= 8, bits >>= 8)
+			data[length++] = uint8_t(bits);
+	}
+
+	size_t finish() noexcept
+	{
+		if (count)
+			data[length++] = uint8_t(bits);
+		count = 0;
+		return length;
+	}
+};
+
+struct bitReader_t final
+{
+private:
+	const uint8_t *const data;
+	const size_t length;
+	size_t offset;
+	uint64_t bits;
+	uint32_t count;
+
+	bool fill(const uint32_t width) noexcept
+	{
+		for (; count < width && offset < length; count += 8)
+			bits |= uint64_t(data[offset++]) << count;
+		return count >= width;
+	}
+
+public:
+	bitReader_t(const uint8_t *const _data, const size_t _length) noexcept :
+		data{_data}, length{_length}, offset{0}, bits{0}, count{0} { }
+
+	bool read(uint32_t &value, const uint32_t width) noexcept
+	{
+		if (!fill(width))
+			return false;
+		value = uint32_t(bits & ((uint64_t(1) << width) - 1));
+		bits >>= width;
+		count -= width;
+		return true;
+	}
+};
+
+// The smallest k for which the values coded have been averaging under 2^k.
+uint32_t riceState_t::parameter() const noexcept
+{
+	uint32_t k{0};
+	while (k < 31 && (uint64_t(count) << k) < total)
+		++k;
+	return k;
+}
+
+void riceState_t::update(const uint32_t value) noexcept
+{
+	total = uint32_t(std::min<uint64_t>(uint64_t(total) + value, UINT32_MAX));
+	if (++count == adaptWindow)
+	{
+		total = std::max(total / 2, 1U);
+		count /= 2;
+	}
+}
+
+void writeRice(bitWriter_t &writer, riceState_t &state, const uint32_t value) noexcept
+{
+	const uint32_t k = state.parameter();
+	const uint32_t unary = value >> k;
+	if (unary < unaryLimit)
+	{
+		writer.write((1U << unary) - 1, unary + 1);
+		if (k)
+			writer.write(value & ((1U << k) - 1), k);
+	}
+	else
+	{
+		writer.write((1U << unaryLimit) - 1, unaryLimit);
+		writer.write(value, 32);
+	}
+	state.update(value);
+}
+
+bool readRice(bitReader_t &reader, riceState_t &state, uint32_t &value) noexcept
+{
+	const uint32_t k = state.parameter();
+	uint32_t unary{0}, bit{1};
+	while (unary < unaryLimit)
+	{
+		if (!reader.read(bit, 1))
+			return false;
+		else if (!bit)
+			break;
+		++unary;
+	}
+
+	if (unary < unaryLimit)
+	{
+		uint32_t remainder{0};
+		if (k && !reader.read(remainder, k))
+			return false;
+		value = (unary << k) | remainder;
+	}
+	else if (!reader.read(value, 32))
+		return false;
+	state.update(value);
+	return true;
+}
+
+escapeCodec_t::escapeCodec_t(const uint32_t _width, const uint32_t _subdiv) noexcept :
+	width{_width}, subdiv{_subdiv}, previous{size_t(_width) * _subdiv * _subdiv}, residuals{}, runs{}
+{
+	if (previous.valid())
+		std::fill(previous.data(), previous.data() + previous.count(), 0);
+}
+
+// Where sample x, y of a row's grid lives - the grid runs top down, while a pixel's samples run bottom up.
+size_t escapeCodec_t::index(const uint32_t x, const uint32_t y) const noexcept
+	{ return (size_t(x / subdiv) * subdiv * subdiv) + (x % subdiv) + ((subdiv - 1 - y) * subdiv); }
+
+// The already coded samples around x, y - at the left edge both left ones stand in as the one above.
+neighbours_t escapeCodec_t::neighbours(const uint32_t *const values, const uint32_t x, const uint32_t y) const noexcept
+{
+	// The bottom row of samples of the previous row of pixels sits above the top row of this one.
+	const uint32_t *const aboveRow = y ? values : previous.data();
+	const uint32_t aboveY = y ? y - 1 : subdiv - 1;
+	const uint32_t above = aboveRow[index(x, aboveY)];
+	if (!x)
+		return {above, above, above};
+	return {values[index(x - 1, y)], above, aboveRow[index(x - 1, aboveY)]};
+}
+
+// The median edge detector - picks the left or above neighbour across an edge, else the plane through all three.
+uint32_t neighbours_t::predict() const noexcept
+{
+	if (aboveLeft >= std::max(left, above))
+		return std::min(left, above);
+	else if (aboveLeft <= std::min(left, above))
+		return std::max(left, above);
+	return left + above - aboveLeft;
+}
+
+// Residuals are coded in a context picked by how busy the neighbourhood is, so the coding
+// parameter follows the image from smooth bands into the noise near the set and back at once.
+uint32_t neighbours_t::context() const noexcept
+{
+	const uint32_t activity = std::max(left, aboveLeft) - std::min(left, aboveLeft) +
+		std::max(above, aboveLeft) - std::min(above, aboveLeft);
+	uint32_t context{0};
+	while (context + 1 < contexts && activity >> context)
+		++context;
+	return context;
+}
+
+size_t escapeCodec_t::encode(const uint32_t *const values, uint8_t *const data) noexcept
+{
+	bitWriter_t writer{data};
+	const uint32_t rowLength = width * subdiv;
+	for (uint32_t y{0}; y < subdiv; ++y)
+	{
+		for (uint32_t x{0}; x < rowLength; ++x)
+		{
+			// Flat neighbourhoods - the set's interior, and far out where everything escapes at
+			// once - are coded as how many samples in a row match the one to their left.
+			if (x && neighbours(values, x, y).flat())
+			{
+				const uint32_t value = values[index(x - 1, y)];
+				uint32_t run{0};
+				while (x + run < rowLength && values[index(x + run, y)] == value)
+					++run;
+				writeRice(writer, runs, run);
+				x += run;
+				// The sample that broke the run is coded as usual.
+				if (x == rowLength)
+					break;
+			}
+			const neighbours_t context = neighbours(values, x, y);
+			writeRice(writer, residuals[context.context()], zigzag(int32_t(values[index(x, y)] - context.predict())));
+		}
+	}
+	std::copy(values, values + previous.count(), previous.data());
+	return writer.finish();
+}
+
+bool escapeCodec_t::decode(const uint8_t *const data, const size_t length, uint32_t *const values) noexcept
+{
+	bitReader_t reader{data, length};
+	const uint32_t rowLength = width * subdiv;
+	for (uint32_t y{0}; y < subdiv; ++y)
+	{
+		for (uint32_t x{0}; x < rowLength; ++x)
+		{
+			uint32_t residual{0};
+			if (x && neighbours(values, x, y).flat())
+			{
+				const uint32_t value = values[index(x - 1, y)];
+				uint32_t run{0};
+				if (!readRice(reader, runs, run) || run > rowLength - x)
+					return false;
+				for (const uint32_t end = x + run; x < end; ++x)
+					values[index(x, y)] = value;
+				if (x == rowLength)
+					break;
+			}
+			const neighbours_t context = neighbours(values, x, y);
+			if (!readRice(reader, residuals[context.context()], residual))
+				return false;
+			values[index(x, y)] = context.predict() + uint32_t(unzigzag(residual));
+		}
+	}
+	std::copy(values, values + previous.count(), previous.data());
+	return true;
+}
@@ -0,0 +1,81 @@
+#ifndef ESCAPE_CODEC__HXX
+#define ESCAPE_CODEC__HXX
+
+#include <stdint.h>
+#include <stddef.h>
+#include <array>
+#include <algorithm>
+#include "render.hxx"
+#include "fixedVector.hxx"
+
+// Escape values travel as fixed point iteration counts with this many fractional bits, which
+// puts the error well under a step of the colour gradient.
+constexpr static const uint32_t escapeFractionBits = 4;
+
+// Interior points are sent as the largest value, which escaped points saturate below.
+constexpr static const uint32_t escapeInterior = UINT32_MAX;
+// The largest iteration limit whose escape values all fit below escapeInterior.
+constexpr static const uint64_t maxEscapeIterations = uint64_t(escapeInterior - 1) >> escapeFractionBits;
+
+inline uint32_t quantise(const double iteration) noexcept
+{
+	if (iteration == interiorPoint)
+		return escapeInterior;
+	return uint32_t(std::min<double>(iteration * (1U << escapeFractionBits), escapeInterior - 1));
+}
+inline double dequantise(const uint32_t value) noexcept
+	{ return value == escapeInterior ? interiorPoint : double(value) / (1U << escapeFractionBits); }
+
+// Tracks how large the values Rice coded with it have been running, to pick the coding parameter.
+struct riceState_t final
+{
+private:
+	uint32_t total, count;
+
+public:
+	constexpr riceState_t() noexcept : total{4}, count{1} { }
+
+	uint32_t parameter() const noexcept;
+	void update(const uint32_t value) noexcept;
+};
+
+// How many classes of neighbourhood residuals are coded in, by how much the neighbours differ.
+constexpr static const uint32_t contexts = 16;
+
+struct neighbours_t final
+{
+	uint32_t left, above, aboveLeft;
+
+	bool flat() const noexcept { return left == above && left == aboveLeft; }
+	uint32_t predict() const noexcept;
+	uint32_t context() const noexcept;
+};
+
+// Codes a tile's escape values a row at a time, subdiv by subdiv values to a pixel stored pixel by
+// pixel. The values are walked as the full resolution grid of samples, each predicted from its
+// neighbours to the left and above, and the residuals are Rice coded with parameters that adapt
+// to how large they have been running. An encoder and a decoder see the same rows in the same
+// order, so stay in step.
+struct escapeCodec_t final
+{
+private:
+	const uint32_t width, subdiv;
+	fixedVector_t<uint32_t> previous;
+	std::array<riceState_t, contexts> residuals;
+	riceState_t runs;
+
+	size_t index(const uint32_t x, const uint32_t y) const noexcept;
+	neighbours_t neighbours(const uint32_t *const values, const uint32_t x, const uint32_t y) const noexcept;
+
+public:
+	escapeCodec_t(const uint32_t _width, const uint32_t _subdiv) noexcept;
+
+	bool valid() const noexcept { return previous.valid(); }
+	// The most a row can take to encode.
+	size_t maxLength() const noexcept { return (previous.count() * 12) + 8; }
+
+	size_t encode(const uint32_t *const values, uint8_t *const data) noexcept;
+	bool decode(const uint8_t *const data, const size_t length, uint32_t *const values) noexcept;
+};
+
+#endif /*ESCAPE_CODEC__HXX*/
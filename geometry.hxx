@@ -0,0 +1,92 @@
+#ifndef GEOMETRY__HXX
+#define GEOMETRY__HXX
+
+#include <stdint.h>
+#include <utility>
+
+struct area_t final
+{
+private:
+	uint32_t _width, _height;
+
+public:
+	constexpr area_t() noexcept : _width(0), _height(0) { }
+	constexpr area_t(const uint32_t x, const uint32_t y) noexcept : _width(x), _height(y) { }
+
+	uint32_t width() const noexcept { return _width; }
+	void width(const uint32_t width) noexcept { _width = width; }
+	uint32_t height() const noexcept { return _height; }
+	void height(const uint32_t height) noexcept { _height = height; }
+
+	area_t operator +(const area_t point) const noexcept
+		{ return {_width + point._width, _height + point._height}; }
+	area_t operator -(const area_t point) const noexcept
+		{ return {_width - point._width, _height - point._height}; }
+	area_t operator *(const area_t point) const noexcept
+		{ return {_width * point._width, _height * point._height}; }
+	area_t operator /(const area_t point) const noexcept
+		{ return {_width / point._width, _height / point._height}; }
+
+	void operator *=(const area_t point) noexcept
+		{ _width *= point._width; _height *= point._height; }
+
+	void swap(area_t &point) noexcept
+	{
+		std::swap(_width, point._width);
+		std::swap(_height, point._height);
+	}
+};
+
+struct point2_t final
+{
+private:
+	double _x, _y;
+
+public:
+	constexpr point2_t() noexcept : _x(0), _y(0) { }
+	constexpr point2_t(const double x, const double y) noexcept : _x(x), _y(y) { }
+
+	double x() const noexcept { return _x; }
+	void x(const double x) noexcept { _x = x; }
+	double y() const noexcept { return _y; }
+	void y(const double y) noexcept { _y = y; }
+
+	point2_t operator +(const point2_t point) const noexcept
+		{ return {_x + point._x, _y + point._y}; }
+	point2_t operator -(const point2_t point) const noexcept
+		{ return {_x - point._x, _y - point._y}; }
+	point2_t operator *(const point2_t point) const noexcept
+		{ return {_x * point._x, _y * point._y}; }
+	point2_t operator /(const point2_t point) const noexcept
+		{ return {_x / point._x, _y / point._y}; }
+	point2_t operator -() const noexcept
+		{ return {-_x, -_y}; }
+
+	point2_t operator *(const area_t point) const noexcept
+		{ return {_x * point.width(), _y * point.height()}; }
+
+	point2_t operator /(const uint32_t scalar) const noexcept
+		{ return {_x / scalar, _y / scalar}; }
+
+	double mul() const noexcept { return _x * _y; }
+	double sum() const noexcept { return _x + _y; }
+	double diff() const noexcept { return _x - _y; }
+
+	void swap(point2_t &point) noexcept
+	{
+		std::swap(_x, point._x);
+		std::swap(_y, point._y);
+	}
+};
+
+inline point2_t operator /(const area_t a, const point2_t b) noexcept
+	{ return {a.width() / b.x(), a.height() / b.y()}; }
+
+// The part of the image a compute process is given to work on.
+struct tile_t final
+{
+	area_t offset;
+	area_t size;
+};
+
+#endif /*GEOMETRY__HXX*/
@@ -0,0 +1,27 @@
+#include <stdio.h>
+#include <string.h>
+#include "imageWriter.hxx"
+#include "pngWriter.hxx"
+#include "ppmWriter.hxx"
+#include "qoiWriter.hxx"
+#include "memory.hxx"
+
+std::unique_ptr<imageWriter_t> makeImageWriter(const char *const format, const uint32_t level) noexcept
+{
+	if (strcmp(format, "png") == 0)
+		return makeUnique<pngWriter_t>(level);
+	else if (strcmp(format, "ppm") == 0)
+		return makeUnique<ppmWriter_t>();
+	else if (strcmp(format, "qoi") == 0)
+		return makeUnique<qoiWriter_t>();
+	return nullptr;
+}
+
+std::unique_ptr<char []> imageFileName(const char *const name, const char *const extension) noexcept
+{
+	const size_t length = strlen(name) + strlen(extension) + 2;
+	auto fileName = makeUnique<char []>(length);
+	if (fileName)
+		snprintf(fileName.get(), length, "%s.%s", name, extension);
+	return fileName;
+}
@@ -0,0 +1,35 @@
+#ifndef IMAGE_WRITER__HXX
+#define IMAGE_WRITER__HXX
+
+#include <stdint.h>
+#include <memory>
+#include "mandelbrot.hxx"
+
+struct imageWriter_t
+{
+public:
+	imageWriter_t() = default;
+	imageWriter_t(const imageWriter_t &) = delete;
+	imageWriter_t(imageWriter_t &&) = default;
+	virtual ~imageWriter_t() = default;
+	imageWriter_t &operator =(const imageWriter_t &) = delete;
+	imageWriter_t &operator =(imageWriter_t &&) = default;
+
+	// Opens the file for an image called name, with the extension for the format added.
+	virtual bool open(const area_t size, const char *const name) noexcept = 0;
+	virtual void close() noexcept = 0;
+	// Rows must be written in order, pixels holding the row's width pixels.
+	virtual void writeRow(const uint32_t row, const rgb8_t *const pixels, const uint32_t width) noexcept = 0;
+	// The output file's own pixels if they can be rendered into directly, in which case
+	// writeRow() has nothing left to do when given the row already in them.
+	virtual rgb8_t *pixels() const noexcept { return nullptr; }
+};
+
+constexpr static const uint32_t maxCompressionLevel = 9;
+
+// Makes the writer for the named format ("png", "ppm" or "qoi"), or nullptr if there is none.
+std::unique_ptr<imageWriter_t> makeImageWriter(const char *const format, const uint32_t level) noexcept;
+// The file name for an image called name, or nullptr if there's no memory for it.
+std::unique_ptr<char []> imageFileName(const char *const name, const char *const extension) noexcept;
+
+#endif /*IMAGE_WRITER__HXX*/
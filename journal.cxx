@@ -0,0 +1,104 @@
+#include <unistd.h>
+#include <string.h>
+#include "journal.hxx"
+
+using namespace std::literals::chrono_literals;
+
+struct journalHeader_t final
+{
+	uint32_t magic;
+	uint32_t version;
+	journalParams_t params;
+};
+
+constexpr static const char *const journalName = "mandelbrot.journal";
+constexpr static const uint32_t journalMagic = 0x4A424D4D; // "MMBJ"
+constexpr static const uint32_t journalVersion = 3;
+constexpr static const auto syncInterval = 30s;
+
+bool journal_t::create(const journalParams_t &params) noexcept
+{
+	const journalHeader_t header{journalMagic, journalVersion, params};
+	done = fixedVector_t<bool>{params.height};
+	if (!done.valid())
+		return false;
+	file = fopen(journalName, "wb");
+	if (!file.valid())
+		return false;
+	else if (fwrite(&header, sizeof(journalHeader_t), 1, file) != 1 || fflush(file))
+	{
+		file.close();
+		return false;
+	}
+	rowLength = sizeof(rgb8_t) * params.width;
+	_rows = 0;
+	lastSync = std::chrono::steady_clock::now();
+	return true;
+}
+
+bool journal_t::resume(const journalParams_t &params, rgb8_t *const image) noexcept
+{
+	journalHeader_t header{};
+	file = fopen(journalName, "r+b");
+	if (!file.valid())
+		return false;
+	else if (fread(&header, sizeof(journalHeader_t), 1, file) != 1 || header.magic != journalMagic ||
+		header.version != journalVersion || header.params != params)
+	{
+		file.close();
+		return false;
+	}
+
+	rowLength = sizeof(rgb8_t) * params.width;
+	_rows = 0;
+	done = fixedVector_t<bool>{params.height};
+	if (!done.valid())
+	{
+		file.close();
+		return false;
+	}
+	long end = long(sizeof(journalHeader_t));
+	uint32_t row{0};
+	while (fread(&row, sizeof(uint32_t), 1, file) == 1 && row < params.height &&
+		fread(&image[size_t(row) * params.width], rowLength, 1, file) == 1)
+	{
+		_rows += !done.data()[row];
+		done.data()[row] = true;
+		end += long(sizeof(uint32_t) + rowLength);
+	}
+	// Drop any partially written row so new rows get appended where they belong.
+	if (fseek(file, end, SEEK_SET) || ftruncate(fileno(file), end))
+	{
+		file.close();
+		return false;
+	}
+	lastSync = std::chrono::steady_clock::now();
+	return true;
+}
+
+void journal_t::writeRow(const uint32_t row, const rgb8_t *const pixels) noexcept
+{
+	if (!file.valid() || done.data()[row])
+		return;
+	if (fwrite(&row, sizeof(uint32_t), 1, file) != 1 || fwrite(pixels, rowLength, 1, file) != 1 || fflush(file))
+	{
+		puts("Failed to write to the journal, checkpointing disabled");
+		file.close();
+		return;
+	}
+	done.data()[row] = true;
+	++_rows;
+
+	const auto now = std::chrono::steady_clock::now();
+	if (now - lastSync >= syncInterval)
+	{
+		fdatasync(fileno(file));
+		lastSync = now;
+	}
+}
+
+void journal_t::remove() noexcept
+{
+	file.close();
+	unlink(journalName);
+}
@@ -0,0 +1,53 @@
+#ifndef JOURNAL__HXX
+#define JOURNAL__HXX
+
+#include <stdint.h>
+#include <chrono>
+#include "mandelbrot.hxx"
+#include "shade.hxx"
+#include "file.hxx"
+#include "fixedVector.hxx"
+
+struct journalParams_t final
+{
+	uint32_t width, height, subdiv;
+	uint32_t xTiles, yTiles, autoIterations;
+	uint64_t maxIterations;
+	double bailout, centerX, centerY, zoom;
+
+	bool operator ==(const journalParams_t &params) const noexcept
+	{
+		return width == params.width && height == params.height && subdiv == params.subdiv &&
+			xTiles == params.xTiles && yTiles == params.yTiles && autoIterations == params.autoIterations &&
+			maxIterations == params.maxIterations && bailout == params.bailout && centerX == params.centerX && centerY == params.centerY && zoom == params.zoom;
+	}
+	bool operator !=(const journalParams_t &params) const noexcept { return !(*this == params); }
+};
+
+// Checkpoint of a render - the view parameters followed by each row of the image, tagged with its
+// index, in whatever order the rows complete, so a render that dies can be resumed skipping every
+// row it finished.
+struct journal_t final
+{
+private:
+	file_t file;
+	size_t rowLength;
+	uint32_t _rows;
+	fixedVector_t<bool> done;
+	std::chrono::steady_clock::time_point lastSync;
+
+public:
+	journal_t() noexcept : file{}, rowLength{0}, _rows{0}, done{}, lastSync{} { }
+
+	bool create(const journalParams_t &params) noexcept;
+	// Reads the completed rows back into image - fails if the journal is missing or for a different view.
+	bool resume(const journalParams_t &params, rgb8_t *const image) noexcept;
+	bool valid() const noexcept { return file.valid(); }
+	uint32_t rows() const noexcept { return _rows; }
+	bool completed(const uint32_t row) const noexcept { return done.valid() && done.data()[row]; }
+	// Records a completed row, unless it already has been.
+	void writeRow(const uint32_t row, const rgb8_t *const pixels) noexcept;
+	void remove() noexcept;
+};
+
+#endif /*JOURNAL__HXX*/
@@ -1,13 +1,20 @@
 #include <fenv.h>
 #include <thread>
 #include <string.h>
+#include <inttypes.h>
 #include "mandelbrot.hxx"
-#include "shade.hxx"
-#include "pngWriter.hxx"
+#include "shader.hxx"
+#include "render.hxx"
+#include "imageWriter.hxx"
+#include "pyramid.hxx"
 #include "argsParser.hxx"
 #include "socket.hxx"
-#include "ringBuffer.hxx"
+#include "sharedImage.hxx"
+#include "reactor.hxx"
+#include "partition.hxx"
+#include "journal.hxx"
 #include "conversions.hxx"
+#include "escapeCodec.hxx"
 
 using namespace std::literals::chrono_literals;
 
@@ -19,28 +26,177 @@ const static arg_t args[] =
 	{"-w", 1, 1, 0},
 	{"-h", 1, 1, 0},
 	{"-s", 1, 1, 0},
+	{"--local", 0, 0, ARG_OPTIONAL},
+	{"--session", 1, 1, ARG_OPTIONAL},
+	{"--resume", 0, 0, ARG_OPTIONAL},
+	{"--format", 1, 1, ARG_OPTIONAL},
+	{"--level", 1, 1, ARG_OPTIONAL},
+	{"--balance", 0, 0, ARG_OPTIONAL},
+	{"--values", 0, 0, ARG_OPTIONAL},
+	{"--iterations", 1, 1, ARG_OPTIONAL},
+	{"--bailout", 1, 1, ARG_OPTIONAL},
+	{"--pyramid", 1, 1, ARG_OPTIONAL},
 	{nullptr, 0, 0, 0}
 };
 parsedArgs_t parsedArgs;
 
 constexpr double zoom = 1;
 constexpr static const point2_t center{-0.5, 0};
+constexpr static const uint32_t maxShaderThreads = 4;
+constexpr static const uint64_t defaultIterations = 1000;
+// Automatic iterations start low so shallow views stay cheap - tiles that need more raise it.
+constexpr static const uint64_t autoStartIterations = 256;
+constexpr static const uint32_t defaultBailout = 256;
+constexpr static const char *const imageName = "mandelbrot";
+// How often the shader process of a local render looks for rows completed out of order to checkpoint.
+constexpr static const auto checkpointInterval = 500ms;
 const char *self = nullptr;
+// Names the shared image of a --local render, so renders on the same host with different sessions stay apart.
+const char *session = "render";
 std::vector<std::string> nodes;
 uint32_t width = 0, height = 0, subdiv = 0, compNodes = 0, selfIndex = 0;
 uint32_t xTiles = 0, yTiles = 1;
-point2_t region;
-bool multiProcess;
+bool multiProcess, localNodes, resume, balance, escapeValues, autoIterations;
+uint64_t maxIterations = defaultIterations;
+double bailout = defaultBailout;
 std::vector<uint32_t> availableProcessors;
+journal_t journal;
+std::unique_ptr<imageWriter_t> writer;
+const char *format = "png";
+uint32_t compressionLevel = maxCompressionLevel, pyramidLevels = 0;
+pyramid_t pyramid;
 
-void writeImage(std::unique_lock<std::mutex> &&lock_) noexcept
+renderRequest_t renderRequest() noexcept
+	{ return {{width, height}, subdiv, center, zoom, maxIterations, autoIterations, bailout, nullptr}; }
+
+// Renders straight into the output file if the writer maps it, otherwise into memory.
+rgb8_t *allocateImage(std::unique_ptr<rgb8_t []> &storage) noexcept
 {
-	auto lock{std::move(lock_)};
+	if (writer->pixels())
+		return writer->pixels();
+	storage = makeUnique<rgb8_t []>(width * height);
+	return storage.get();
+}
+
+// Opens the output image, along with its pyramid if one was asked for.
+bool openImage(const area_t size) noexcept
+{
+	if (!writer->open(size, imageName))
+		return false;
+	else if (!pyramid.open(size, imageName, pyramidLevels, format, compressionLevel))
+	{
+		puts("Failed to open the pyramid levels");
+		return false;
+	}
+	return true;
+}
+
+void closeImage() noexcept
+{
+	writer->close();
+	pyramid.close();
+}
+
+// Sets up the journal, recovering the rows of a previous run from it for --resume.
+bool prepareJournal() noexcept
+{
+	const journalParams_t params{width, height, subdiv, xTiles, yTiles, autoIterations, maxIterations,
+		bailout, center.x(), center.y(), zoom};
+	if (resume)
+	{
+		if (!journal.resume(params, image))
+		{
+			puts("Failed to resume, the journal is missing or was for a different render");
+			return false;
+		}
+		printf("Resuming render with %u of %u rows already complete\n", journal.rows(), height);
+	}
+	else if (!journal.create(params))
+		puts("Failed to create the journal, continuing without checkpointing");
+
 	for (uint32_t i{0}; i < height; ++i)
+		imageStatus[i] = 0;
+	return true;
+}
+
+// Trims the rows recovered from the journal off the top of each compute process's tile, counting
+// the tiles' share of them as done. Compute processes work down their tile a row at a time, so
+// their completed rows are nearly always at the top - the odd completed row after one that isn't
+// is computed again.
+void skipRows(fixedVector_t<tile_t> &tiles) noexcept
+{
+	for (tile_t &tile : tiles)
 	{
+		const uint32_t top = tile.offset.height();
+		uint32_t skip{0};
+		for (; skip < tile.size.height() && journal.completed(top + skip); ++skip)
+			++imageStatus[top + skip];
+		tile.offset.height(top + skip);
+		tile.size.height(tile.size.height() - skip);
+	}
+}
+
+// Checkpoints a row as soon as it is complete, whatever order the rows complete in.
+void journalRow(const uint32_t row) noexcept
+	{ journal.writeRow(row, &image[size_t(row) * width]); }
+
+// With --iterations auto, picks the limit once for the whole view so every tile renders with it -
+// tiles picking their own would leave seams wherever neighbours picked differently.
+void pickIterations() noexcept
+{
+	if (!autoIterations)
+		return;
+	maxIterations = viewIterations(renderRequest(), availableProcessors.size());
+	autoIterations = false;
+	printf("Picked an iteration limit of %" PRIu64 " for the view\n", maxIterations);
+}
+
+fixedVector_t<tile_t> partitionImage() noexcept
+{
+	if (balance)
+		puts("Estimating the cost of the view to balance the tiles");
+	return partition(renderRequest(), balance);
+}
+
+void writeImage() noexcept
+{
+	uint32_t row{0};
+	for (uint32_t i{0}; i < height; ++i)
+	{
+		while (completedRows.tryPop(row))
+			journalRow(row);
 		while (imageStatus[i] < xTiles)
-			imageSync.wait_for(lock, 50us);
-		writePNGRow(i, width);
+			journalRow(completedRows.pop());
+		writer->writeRow(i, &image[i * width], width);
+		pyramid.writeRow(&image[i * width]);
+		journalRow(i);
+		fflush(stdout);
+	}
+}
+
+void writeImage(const sharedImage_t &sharedImage) noexcept
+{
+	auto lastScan = std::chrono::steady_clock::now();
+	for (uint32_t i{0}; i < height; ++i)
+	{
+		// There's no queue of completed rows here, so every so often look for any later rows that
+		// have completed while waiting on this one.
+		for (bool complete{false}; !complete; )
+		{
+			complete = sharedImage.waitRow(i, xTiles, checkpointInterval);
+			const auto now = std::chrono::steady_clock::now();
+			if (now - lastScan < checkpointInterval)
+				continue;
+			for (uint32_t j{i + 1}; j < height; ++j)
+			{
+				if (imageStatus[j] >= xTiles)
+					journalRow(j);
+			}
+			lastScan = now;
+		}
+		writer->writeRow(i, &image[i * width], width);
+		pyramid.writeRow(&image[i * width]);
+		journalRow(i);
 		fflush(stdout);
 	}
 }
@@ -48,15 +204,21 @@ void writeImage(std::unique_lock<std::mutex> &&lock_) noexcept
 int server(socketStream_t &socket) noexcept
 {
 	const area_t size{width, height};
-	std::unique_lock<std::mutex> lock(imageMutex);
-	auto shaderThreads = makeUnique<std::thread []>(compNodes - 1);
-	image = makeUnique<rgb8_t []>(width * height);
-	imageStatus = makeUnique<std::atomic<uint32_t> []>(height);
-	if (!image || !imageStatus || !openPNG(size))
+	const uint32_t computeNodes = compNodes - 1;
+	std::unique_ptr<rgb8_t []> imageStorage;
+	auto imageStatusStorage = makeUnique<std::atomic<uint32_t> []>(height);
+	imageStatus = imageStatusStorage.get();
+	if (!imageStatus || !completedRows.reset(height) || !openImage(size))
+		return 1;
+	image = allocateImage(imageStorage);
+	if (!image || !prepareJournal())
 		return 1;
+	pickIterations();
+	fixedVector_t<tile_t> tiles = partitionImage();
+	if (!tiles.valid())
+		return 1;
+	skipRows(tiles);
 	printf("Setting up render of %u by %u Mandelbrot Set\n", width, height);
-	for (uint32_t i{0}; i < height; ++i)
-		imageStatus[i] = 0;
 
 	if (!socket.listen(nodes[0].data(), 2000))
 	{
@@ -65,59 +227,91 @@ int server(socketStream_t &socket) noexcept
 	}
 	puts("Shader process ready for connetions");
 
-	const area_t subchunk{width / xTiles, height / yTiles};
-	printf("Launching shaders for %u subchunks of %u by %u\n",
-		compNodes - 1, subchunk.width(), subchunk.height());
-	for (uint32_t i{1}; i < compNodes; ++i)
+	shadeReactor_t reactor{socket, size, tiles, maxIterations, escapeValues ? subdiv : 0};
+	if (!reactor.start(std::min(maxShaderThreads, computeNodes)))
 	{
-		const uint32_t tile = i - 1;
-		const area_t location{tile % xTiles, tile / xTiles};
-		socketStream_t stream = socket.accept();
-		if (!stream.valid())
-		{
-			puts("Failed to aquire socket for incomming connection");
-			abort();
-		}
-
-		shaderThreads[tile] = std::thread([=](socketStream_t stream, const uint32_t affinityOffset) noexcept
-			{ shadeChunk(size, subchunk, subdiv * subdiv, stream, affinityOffset); },
-			std::move(stream), tile
-		);
+		puts("Failed to start the shader threads");
+		return 1;
 	}
 
 	fflush(stdout);
-	writeImage(std::move(lock));
+	writeImage();
 	puts("Reaping shaders");
-	for (uint32_t i{1}; i < compNodes; ++i)
-		shaderThreads[i - 1].join();
-	closePNG();
+	reactor.join();
+	closeImage();
+	journal.remove();
 	return 0;
 }
 
-int client(stream_t &stream) noexcept
+int localServer() noexcept
 {
 	const area_t size{width, height};
-	const area_t subchunk{size / area_t{xTiles, yTiles}};
-	const point2_t scale{size / region};
-	const uint32_t tile = selfIndex ? selfIndex - 1 : 0;
-	const area_t location{tile % xTiles, tile / xTiles};
+	sharedImage_t sharedImage = sharedImage_t::create(session, size, compNodes - 1);
+	if (!sharedImage.valid())
+	{
+		printf("Failed to create the shared image, is another render running as session %s?\n", session);
+		return 2;
+	}
+	image = sharedImage.pixels();
+	imageStatus = sharedImage.status();
+	if (!openImage(size) || !prepareJournal())
+		return 1;
+	pickIterations();
+	fixedVector_t<tile_t> tiles = partitionImage();
+	if (!tiles.valid())
+		return 1;
+	skipRows(tiles);
+	std::copy(tiles.data(), tiles.data() + tiles.count(), sharedImage.tiles());
+	printf("Setting up render of %u by %u Mandelbrot Set in shared memory\n", width, height);
+	fflush(stdout);
+	sharedImage.ready(maxIterations);
+	writeImage(sharedImage);
+	closeImage();
+	journal.remove();
+	return 0;
+}
 
-	if (multiProcess)
+int localClient() noexcept
+{
+	const area_t size{width, height};
+	sharedImage_t sharedImage = sharedImage_t::open(session, size, compNodes - 1);
+	if (!sharedImage.valid())
 	{
-		puts("Compute process sleeping 1 second before starting");
-		std::this_thread::sleep_for(1s);
-		socketStream_t &socket = reinterpret_cast<socketStream_t &>(stream);
-		if (!socket.connect(nodes[0].data(), 2000))
-		{
-			puts("Failed to connect to the shader process");
-			return 2;
-		}
+		puts("Failed to open the shared image");
+		return 2;
 	}
+	const tile_t tile = sharedImage.tiles()[selfIndex - 1];
+	maxIterations = sharedImage.maxIterations();
+	autoIterations = false;
+	printf("Computing a subchunk of %u by %u, at %u, %u into shared memory\n",
+		tile.size.width(), tile.size.height(), tile.offset.width(), tile.offset.height());
 
-	printf("Computing a subchunk of %u by %u, at location %u, %u\n",
-		subchunk.width(), subchunk.height(), location.width(), location.height());
-	write(stream, location);
-	computeChunk(subchunk, subchunk * location, scale, center, subdiv, stream);
+	// There's no wire to save bytes on, so pixels are always written straight into the shared image.
+	sharedImageStream_t stream{sharedImage, width, tile.size, tile.offset};
+	computeChunk(renderRequest(), tile, false, stream);
+	return 0;
+}
+
+int client(socketStream_t &stream) noexcept
+{
+	tile_t tile{};
+	puts("Compute process sleeping 1 second before starting");
+	std::this_thread::sleep_for(1s);
+	if (!stream.connect(nodes[0].data(), 2000))
+	{
+		puts("Failed to connect to the shader process");
+		return 2;
+	}
+	else if (!read(stream, tile) || !read(stream, maxIterations))
+	{
+		puts("Failed to receive a tile from the shader process");
+		return 2;
+	}
+	autoIterations = false;
+
+	printf("Computing a subchunk of %u by %u, at %u, %u\n",
+		tile.size.width(), tile.size.height(), tile.offset.width(), tile.offset.height());
+	computeChunk(renderRequest(), tile, escapeValues, stream);
 	return 0;
 }
 
@@ -128,23 +322,94 @@ bool imageSize() noexcept
 	const toInt_t<uint32_t> subdivStr(findArg(parsedArgs, "-s", nullptr)->params[0].get());
 	const toInt_t<uint32_t> xTilesStr(findArg(parsedArgs, "--compute", nullptr)->params[0].get());
 	if (!widthStr.isInt() || !heightStr.isInt() || !subdivStr.isInt() ||
-		!xTilesStr.isInt() || xTilesStr > compNodes || subdivStr == 0)
+		!xTilesStr.isInt() || xTilesStr > compNodes || xTilesStr == 0 || subdivStr == 0)
 		return false;
 	const uint32_t computeNodes = compNodes - 1;
 	if (multiProcess && (computeNodes % xTilesStr) != 0)
 		return false;
+	// Every tile needs at least one pixel each way, or its compute process has no rows to complete.
+	else if (widthStr < xTilesStr || (multiProcess && heightStr < computeNodes / xTilesStr))
+		return false;
 	std::tie(width, height, subdiv, xTiles) = std::tie(widthStr, heightStr, subdivStr, xTilesStr);
 	return true;
 }
 
-void calculateRegion() noexcept
+bool selectWriter() noexcept
+{
+	const auto formatArg = findArg(parsedArgs, "--format", nullptr);
+	const auto levelArg = findArg(parsedArgs, "--level", nullptr);
+	const auto pyramidArg = findArg(parsedArgs, "--pyramid", nullptr);
+	if (levelArg)
+	{
+		const toInt_t<uint32_t> levelStr(levelArg->params[0].get());
+		if (!levelStr.isInt() || levelStr > maxCompressionLevel)
+			return false;
+		compressionLevel = levelStr;
+	}
+	if (pyramidArg)
+	{
+		const toInt_t<uint32_t> pyramidStr(pyramidArg->params[0].get());
+		if (!pyramidStr.isInt() || pyramidStr == 0 || pyramidStr > maxPyramidLevels)
+			return false;
+		pyramidLevels = pyramidStr;
+	}
+	if (formatArg)
+		format = formatArg->params[0].get();
+	writer = makeImageWriter(format, compressionLevel);
+	return bool(writer);
+}
+
+bool iterationLimits() noexcept
+{
+	const auto iterationsArg = findArg(parsedArgs, "--iterations", nullptr);
+	const auto bailoutArg = findArg(parsedArgs, "--bailout", nullptr);
+	if (iterationsArg && strcmp(iterationsArg->params[0].get(), "auto") == 0)
+	{
+		autoIterations = true;
+		maxIterations = autoStartIterations;
+	}
+	else if (iterationsArg)
+	{
+		const toInt_t<uint64_t> iterationsStr(iterationsArg->params[0].get());
+		// --values would saturate the escape values of any point escaping past maxEscapeIterations.
+		if (!iterationsStr.isInt() || iterationsStr == 0 || (escapeValues && iterationsStr > maxEscapeIterations))
+			return false;
+		maxIterations = iterationsStr;
+	}
+
+	if (bailoutArg)
+	{
+		const toInt_t<uint32_t> bailoutStr(bailoutArg->params[0].get());
+		if (!bailoutStr.isInt() || bailoutStr < 2)
+			return false;
+		bailout = bailoutStr;
+	}
+	return true;
+}
+
+void calculateTiles() noexcept
 {
-	double base = std::min(width, height) / (2.0 / zoom);
-	region = {width / base, height / base};
 	if (multiProcess)
 		yTiles = (compNodes - 1) / xTiles;
 }
 
+bool checkArgs() noexcept
+{
+	if (!parsedArgs)
+		return false;
+	for (const arg_t *arg = args; arg->value; ++arg)
+	{
+		if (!(arg->flags & ARG_OPTIONAL) && !findArg(parsedArgs, arg->value, nullptr))
+			return false;
+	}
+	for (uint32_t i{0}; parsedArgs[i]; ++i)
+	{
+		if (!findArgInArgs(parsedArgs[i]->value))
+			return false;
+	}
+	return true;
+}
+
 void masterAffinity() noexcept
 {
 	cpu_set_t affinity = {};
@@ -171,7 +436,7 @@ int main(int argc, char **argv) noexcept
 {
 	registerArgs(args);
 	parsedArgs = parseArguments(argc, argv);
-	if (!parsedArgs || countParsedArgs(parsedArgs) != 6)
+	if (!checkArgs())
 	{
 		puts("Failed to parse my command line arguments");
 		return 2;
@@ -183,6 +448,13 @@ int main(int argc, char **argv) noexcept
 	catch (const std::bad_alloc &) { abort(); }
 	compNodes = nodes.size();
 	multiProcess = compNodes > 1;
+	localNodes = findArg(parsedArgs, "--local", nullptr);
+	const auto sessionArg = findArg(parsedArgs, "--session", nullptr);
+	if (sessionArg)
+		session = sessionArg->params[0].get();
+	resume = findArg(parsedArgs, "--resume", nullptr);
+	balance = findArg(parsedArgs, "--balance", nullptr);
+	escapeValues = findArg(parsedArgs, "--values", nullptr);
 
 	for (uint32_t i{0}; i < compNodes; ++i)
 	{
@@ -193,13 +465,36 @@ int main(int argc, char **argv) noexcept
 		}
 	}
 
-	if (!imageSize())
+	if (!validSession(session))
+	{
+		puts("The session must be a non-empty name without slashes");
+		return 1;
+	}
+	else if (localNodes && escapeValues)
+	{
+		puts("--values only applies to renders over TCP, --local renders always write pixels to the shared image");
+		return 1;
+	}
+	else if (!imageSize())
 	{
 		puts("Width and height and subdivisions must all be positive integral values");
-		puts("and the number of divisions of x specified must be cleanly divisible into the number of workers");
+		puts("and the number of divisions of x specified must be cleanly divisible into the number of workers,");
+		puts("with the image no smaller than the tiles it's split into in either direction");
+		return 1;
+	}
+	calculateTiles();
+	if (!iterationLimits())
+	{
+		puts("Iterations must be a positive integral value or auto, and the bailout radius at least 2");
+		printf("with no more than %" PRIu64 " iterations for --values\n", maxEscapeIterations);
+		return 1;
+	}
+	if (!selectWriter())
+	{
+		puts("The output format must be one of png, ppm or qoi, the level between 0 and 9");
+		printf("and the number of pyramid levels between 1 and %u\n", maxPyramidLevels);
 		return 1;
 	}
-	calculateRegion();
 
 	fenv_t fenv;
 	if (feholdexcept(&fenv))
@@ -209,7 +504,9 @@ int main(int argc, char **argv) noexcept
 	}
 	masterAffinity();
 
-	if (multiProcess)
+	if (multiProcess && localNodes)
+		return nodes[0] == self ? localServer() : localClient();
+	else if (multiProcess)
 	{
 		socketStream_t stream{socketType_t::ipv4};
 		if (nodes[0] == self)
@@ -218,26 +515,45 @@ int main(int argc, char **argv) noexcept
 	}
 	else
 	{
-		ringStream_t stream;
-		std::unique_lock<std::mutex> lock(imageMutex);
-
-		image = makeUnique<rgb8_t []>(width * height);
-		imageStatus = makeUnique<std::atomic<uint32_t> []>(height);
-		if (!image || !imageStatus || !openPNG({width, height}))
+		std::unique_ptr<rgb8_t []> imageStorage;
+		auto imageStatusStorage = makeUnique<std::atomic<uint32_t> []>(height);
+		imageStatus = imageStatusStorage.get();
+		if (!imageStatus || !completedRows.reset(height) || !openImage({width, height}))
+			return 1;
+		image = allocateImage(imageStorage);
+		fixedVector_t<bool> doneRows{height};
+		if (!image || !doneRows.valid() || !prepareJournal())
 			return 1;
+		// The renderer finishes rows in pairs either side of the axis rather than top down, so it
+		// skips the rows recovered wherever they are.
 		for (uint32_t i{0}; i < height; ++i)
-			imageStatus[i] = 0;
-
-		std::thread computeThread(client, std::ref(stream));
-		std::thread shaderThread([](stream_t &stream) noexcept
-			{ shadeChunk({width, height}, {width, height}, subdiv * subdiv, stream, (subdiv * subdiv) + 1); },
-			std::ref(stream)
-		);
-
-		writeImage(std::move(lock));
-		computeThread.join();
-		shaderThread.join();
-		closePNG();
+		{
+			doneRows.data()[i] = journal.completed(i);
+			if (doneRows.data()[i])
+				imageStatus[i] = xTiles;
+		}
+
+		// The render thread works rows too, so together with the pool there's a thread per processor.
+		renderPool_t pool{std::max<uint32_t>(availableProcessors.size(), 1) - 1};
+		if (!pool.valid())
+			return 1;
+		renderRequest_t request = renderRequest();
+		request.doneRows = doneRows.data();
+		std::thread renderThread([&]() noexcept
+		{
+			const bool rendered = pool.render(request, image, [](const uint32_t row) noexcept
+			{
+				imageStatus[row] = xTiles;
+				completedRows.push(row);
+			});
+			if (!rendered)
+				abort();
+		});
+
+		writeImage();
+		renderThread.join();
+		closeImage();
+		journal.remove();
 	}
 
 	feupdateenv(&fenv);
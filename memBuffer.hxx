@@ -32,9 +32,26 @@ public:
 		return buffer[readIndex++];
 	}
 
+	// Random-access read that does not consume - waits for index to have been written.
+	T read(const uint32_t index) const noexcept
+	{
+		if (index >= writeIndex)
+		{
+			std::unique_lock<std::mutex> lock(bufferMutex);
+			bufferCond.wait(lock, [&]() noexcept { return index < writeIndex; });
+		}
+		return buffer[index];
+	}
+
 	void write(const T &value) noexcept
 	{
-		buffer[writeIndex++] = value;
+		// Store before publishing the new index so readers never see a slot before it's filled, and
+		// publish it under the lock so a reader can't check it and then miss the wakeup.
+		buffer[writeIndex] = value;
+		{
+			std::lock_guard<std::mutex> lock(bufferMutex);
+			++writeIndex;
+		}
 		bufferCond.notify_all();
 	}
 };
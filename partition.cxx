@@ -0,0 +1,219 @@
+#include <algorithm>
+#include <atomic>
+#include <thread>
+#include "partition.hxx"
+#include "memory.hxx"
+
+// Each sample of the pre-pass stands in for a cell of this many pixels square.
+constexpr static const uint32_t costCell = 8;
+// Roughly what a sample costs besides iterating, in iterations - smoothing the count of a point
+// that escaped, and shading and passing on every sample, copied from its mirror or not.
+constexpr static const uint64_t escapeCost = 36;
+constexpr static const uint64_t sampleCost = 18;
+
+inline uint32_t cells(const uint32_t pixels) noexcept
+	{ return (pixels + costCell - 1) / costCell; }
+
+// Cuts extent pixels into count parts, returning where each part starts followed by the extent.
+fixedVector_t<uint32_t> equalCut(const uint32_t extent, const uint32_t count)
+{
+	fixedVector_t<uint32_t> bounds{count + 1};
+	if (!bounds.valid())
+		return {};
+	for (uint32_t i{0}; i <= count; ++i)
+		bounds[i] = uint32_t((uint64_t(extent) * i) / count);
+	return bounds;
+}
+
+// As equalCut(), but cutting cost - one entry per cell - into parts of about the same total.
+fixedVector_t<uint32_t> costCut(const fixedVector_t<uint64_t> &cost, const uint32_t extent,
+	const uint32_t count)
+{
+	const uint32_t cellCount = cost.count();
+	if (cellCount < count)
+		return equalCut(extent, count);
+	fixedVector_t<uint32_t> bounds{count + 1};
+	fixedVector_t<uint64_t> prefix{cellCount + 1};
+	if (!bounds.valid() || !prefix.valid())
+		return {};
+	prefix[0] = 0;
+	for (uint32_t i{0}; i < cellCount; ++i)
+		prefix[i + 1] = prefix[i] + cost[i];
+
+	bounds[0] = 0;
+	uint32_t cell{0};
+	for (uint32_t i{1}; i < count; ++i)
+	{
+		const uint64_t target = (prefix[cellCount] * i) / count;
+		while (cell < cellCount && prefix[cell] < target)
+			++cell;
+		// Take whichever of the cells either side of the target is closer to it.
+		uint32_t bound = cell;
+		if (bound && target - prefix[bound - 1] < prefix[bound] - target)
+			--bound;
+		// Every part gets at least one cell.
+		bound = std::max(bound, bounds[i - 1] / costCell + 1);
+		bound = std::min(bound, cellCount - (count - i));
+		bounds[i] = bound * costCell;
+	}
+	bounds[count] = extent;
+	return bounds;
+}
+
+// The cost of count cells of cell row row in a band of tiles starting at cell row start - only that
+// of passing the samples on if the row mirrors one of the same band about the real axis, as compute
+// processes copy those.
+inline uint64_t bandCost(const uint64_t cost, const uint32_t count, const fixedVector_t<uint32_t> &mirror,
+	const uint32_t start, const uint32_t row) noexcept
+	{ return mirror[row] < row && mirror[row] >= start ? sampleCost * count : cost; }
+
+// As costCut(), but cutting the rows of cells into bands knowing which rows mirror which - so a
+// band straddling the axis is given more rows. Finds the smallest limit on a band's cost that
+// cutting greedily from the top can keep every band under.
+fixedVector_t<uint32_t> mirroredCut(const fixedVector_t<uint64_t> &cost, const uint32_t rowCells,
+	const fixedVector_t<uint32_t> &mirror, const uint32_t extent, const uint32_t count)
+{
+	const uint32_t cellCount = cost.count();
+	if (cellCount < count)
+		return equalCut(extent, count);
+	fixedVector_t<uint32_t> bounds{count + 1};
+	if (!bounds.valid())
+		return {};
+
+	const auto cut = [&](const uint64_t limit) noexcept
+	{
+		uint32_t row{0};
+		for (uint32_t i{0}; i < count; ++i)
+		{
+			const uint32_t start = row;
+			bounds[i] = start * costCell;
+			// Every band gets at least one cell, leaving one for each band after it - the last takes the rest.
+			const uint32_t end = i + 1 == count ? cellCount : cellCount - (count - i - 1);
+			uint64_t total = bandCost(cost[row], rowCells, mirror, start, row);
+			for (++row; row < end; ++row)
+			{
+				const uint64_t next = bandCost(cost[row], rowCells, mirror, start, row);
+				if (i + 1 != count && total + next > limit)
+					break;
+				total += next;
+			}
+			if (total > limit)
+				return false;
+		}
+		return true;
+	};
+
+	uint64_t low{0}, high{0};
+	for (uint32_t i{0}; i < cellCount; ++i)
+		high += cost[i];
+	while (low < high)
+	{
+		const uint64_t limit = low + ((high - low) / 2);
+		if (cut(limit))
+			high = limit;
+		else
+			low = limit + 1;
+	}
+	cut(high);
+	bounds[count] = extent;
+	return bounds;
+}
+
+// Estimates the cost of each cell from the iterations taken at its centre.
+fixedVector_t<uint64_t> costMap(const renderRequest_t &request) noexcept
+{
+	const area_t size = request.size;
+	const area_t map{cells(size.width()), cells(size.height())};
+	const point2_t scale = renderScale(request);
+	const point2_t origin = renderOrigin(request, scale);
+	const double bailout = request.bailout * request.bailout;
+	const uint32_t maxY = size.height() - 1;
+	fixedVector_t<uint64_t> cost{size_t(map.width()) * map.height()};
+	const uint32_t threadCount = std::max<uint32_t>(availableProcessors.size(), 1);
+	auto threads = makeUnique<std::thread []>(threadCount);
+	if (!cost.valid() || !threads)
+		return {};
+
+	std::atomic<uint32_t> nextRow{0};
+	for (uint32_t i{0}; i < threadCount; ++i)
+		threads[i] = std::thread([&]() noexcept
+		{
+			for (uint32_t y = nextRow++; y < map.height(); y = nextRow++)
+			{
+				const uint32_t pixelY = std::min((y * costCell) + (costCell / 2), maxY);
+				for (uint32_t x{0}; x < map.width(); ++x)
+				{
+					const uint32_t pixelX = std::min((x * costCell) + (costCell / 2), size.width() - 1);
+					const double iterations = computePoint((area_t{pixelX, maxY - pixelY} / scale) + origin,
+						request.maxIterations, bailout);
+					cost.data()[(y * map.width()) + x] = sampleCost +
+						(iterations == interiorPoint ? request.maxIterations : uint64_t(iterations) + escapeCost);
+				}
+			}
+		});
+	for (uint32_t i{0}; i < threadCount; ++i)
+		threads[i].join();
+	return cost;
+}
+
+fixedVector_t<tile_t> partition(const renderRequest_t &request, const bool balance) noexcept try
+{
+	const area_t size = request.size;
+	fixedVector_t<tile_t> tiles{size_t(xTiles) * yTiles};
+	const area_t map{cells(size.width()), cells(size.height())};
+	fixedVector_t<uint64_t> cost = balance ? costMap(request) : fixedVector_t<uint64_t>{};
+	fixedVector_t<uint64_t> rowCost{balance ? map.height() : 0};
+	fixedVector_t<uint64_t> columnCost{balance ? map.width() : 0};
+	fixedVector_t<uint32_t> mirror{balance ? map.height() : 0};
+	if (!tiles.valid() || (balance && (!cost.valid() || !rowCost.valid() || !columnCost.valid() || !mirror.valid())))
+		return {};
+
+	if (balance)
+	{
+		// Each cell row below the real axis mirrors the one holding the sample row its centre mirrors.
+		const int64_t axis = mirrorAxis(request);
+		const uint32_t subdiv = request.subdiv;
+		const uint32_t maxY = size.height() - 1;
+		for (uint32_t y{0}; y < map.height(); ++y)
+		{
+			rowCost[y] = 0;
+			for (uint32_t x{0}; x < map.width(); ++x)
+				rowCost[y] += cost[(y * map.width()) + x];
+			const uint32_t pixelY = std::min((y * costCell) + (costCell / 2), maxY);
+			const int64_t sample = (int64_t(maxY - pixelY) * subdiv) + (subdiv / 2);
+			const int64_t mirrored = axis - sample;
+			mirror[y] = axis && mirrored > sample && mirrored < int64_t(size.height()) * subdiv ?
+				(maxY - uint32_t(mirrored / subdiv)) / costCell : y;
+		}
+	}
+	const auto rows = balance ? mirroredCut(rowCost, map.width(), mirror, size.height(), yTiles) :
+		equalCut(size.height(), yTiles);
+	if (!rows.valid())
+		return {};
+
+	for (uint32_t ty{0}; ty < yTiles; ++ty)
+	{
+		if (balance)
+		{
+			const uint32_t top = rows[ty] / costCell;
+			const uint32_t bottom = ty + 1 == yTiles ? map.height() : rows[ty + 1] / costCell;
+			for (uint32_t x{0}; x < map.width(); ++x)
+			{
+				columnCost[x] = 0;
+				for (uint32_t y{top}; y < bottom; ++y)
+					columnCost[x] += bandCost(cost[(y * map.width()) + x], 1, mirror, top, y);
+			}
+		}
+		const auto columns = balance ? costCut(columnCost, size.width(), xTiles) : equalCut(size.width(), xTiles);
+		if (!columns.valid())
+			return {};
+		for (uint32_t tx{0}; tx < xTiles; ++tx)
+		{
+			tile_t &tile = tiles[(ty * xTiles) + tx];
+			tile.offset = {columns[tx], rows[ty]};
+			tile.size = area_t{columns[tx + 1], rows[ty + 1]} - tile.offset;
+		}
+	}
+	return tiles;
+}
+catch (const std::exception &) { return {}; }
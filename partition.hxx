@@ -0,0 +1,13 @@
+#ifndef PARTITION__HXX
+#define PARTITION__HXX
+
+#include "mandelbrot.hxx"
+#include "fixedVector.hxx"
+
+// Splits the image into xTiles by yTiles tiles - rows of tiles, each tile spanning the full
+// height of its row. Without balancing the split is by area, otherwise a low resolution pre-pass
+// of the view estimates the iterations each part of the image needs and the split is by that -
+// allowing for the rows a tile copies from their mirror about the real axis rather than computing.
+fixedVector_t<tile_t> partition(const renderRequest_t &request, const bool balance) noexcept;
+
+#endif /*PARTITION__HXX*/
@@ -1,16 +1,13 @@
 #include <png.h>
 #include <zlib.h>
-#include "shade.hxx"
 #include "pngWriter.hxx"
-#include "file.hxx"
 
-file_t file;
-png_structp png;
-png_infop info;
-
-bool openPNG(const area_t size) noexcept
+bool pngWriter_t::open(const area_t size, const char *const name) noexcept
 {
-	file = fopen("mandelbrot.png", "wb");
+	const auto fileName = imageFileName(name, "png");
+	if (!fileName)
+		return false;
+	file = fopen(fileName.get(), "wb");
 	if (!file.valid())
 		return false;
 
@@ -24,7 +21,7 @@ bool openPNG(const area_t size) noexcept
 		return false;
 	}
 	png_init_io(png, file);
-	png_set_compression_level(png, Z_BEST_COMPRESSION);
+	png_set_compression_level(png, level);
 	png_set_IHDR(png, info, size.width(), size.height(), 8, PNG_COLOR_TYPE_RGB,
 		PNG_INTERLACE_NONE, PNG_COMPRESSION_TYPE_DEFAULT, PNG_FILTER_TYPE_DEFAULT);
 	png_write_info(png, info);
@@ -32,15 +29,12 @@ bool openPNG(const area_t size) noexcept
 	return true;
 }
 
-void closePNG() noexcept
+void pngWriter_t::close() noexcept
 {
 	png_write_end(png, info);
 	png_destroy_write_struct(&png, &info);
 	file.close();
 }
 
-void writePNGRow(const uint32_t row, const uint32_t width) noexcept
-{
-	png_byte *const rowData = reinterpret_cast<png_byte *>(&image[row * width]);
-	png_write_row(png, rowData);
-}
+void pngWriter_t::writeRow(const uint32_t, const rgb8_t *const pixels, const uint32_t) noexcept
+	{ png_write_row(png, reinterpret_cast<png_const_bytep>(pixels)); }
@@ -1,11 +1,24 @@
 #ifndef PNG_WRITER__HXX
 #define PNG_WRITER__HXX
 
-#include "mandelbrot.hxx"
-#include "shade.hxx"
+#include <png.h>
+#include "imageWriter.hxx"
+#include "file.hxx"
 
-bool openPNG(const area_t size) noexcept;
-void closePNG() noexcept;
-void writePNGRow(const uint32_t row, const uint32_t width) noexcept;
+struct pngWriter_t final : public imageWriter_t
+{
+private:
+	file_t file;
+	png_structp png;
+	png_infop info;
+	uint32_t level;
+
+public:
+	pngWriter_t(const uint32_t _level) noexcept : file{}, png{nullptr}, info{nullptr}, level{_level} { }
+
+	bool open(const area_t size, const char *const name) noexcept final override;
+	void close() noexcept final override;
+	void writeRow(const uint32_t row, const rgb8_t *const pixels, const uint32_t width) noexcept final override;
+};
 
 #endif /*PNG_WRITER__HXX*/
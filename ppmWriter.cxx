@@ -0,0 +1,54 @@
+#include <sys/mman.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <stdio.h>
+#include <string.h>
+#include "ppmWriter.hxx"
+
+bool ppmWriter_t::open(const area_t size, const char *const name) noexcept
+{
+	char header[32];
+	const int result = snprintf(header, sizeof(header), "P6\n%u %u\n255\n", size.width(), size.height());
+	if (result < 0 || size_t(result) >= sizeof(header))
+		return false;
+	headerLength = size_t(result);
+	length = headerLength + (sizeof(rgb8_t) * size.width() * size.height());
+
+	const auto fileName = imageFileName(name, "ppm");
+	if (!fileName)
+		return false;
+	fd = ::open(fileName.get(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+	if (fd == -1)
+		return false;
+	void *const map = ftruncate(fd, length) ? MAP_FAILED :
+		mmap(nullptr, length, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+	if (map == MAP_FAILED)
+	{
+		::close(fd);
+		fd = -1;
+		return false;
+	}
+	memory = static_cast<char *>(map);
+	memcpy(memory, header, headerLength);
+	return true;
+}
+
+void ppmWriter_t::close() noexcept
+{
+	if (memory)
+		munmap(memory, length);
+	if (fd != -1)
+		::close(fd);
+	memory = nullptr;
+	fd = -1;
+}
+
+void ppmWriter_t::writeRow(const uint32_t row, const rgb8_t *const pixels, const uint32_t width) noexcept
+{
+	rgb8_t *const rowData = this->pixels() + (row * width);
+	if (pixels != rowData)
+		memcpy(rowData, pixels, sizeof(rgb8_t) * width);
+}
+
+rgb8_t *ppmWriter_t::pixels() const noexcept
+	{ return memory ? reinterpret_cast<rgb8_t *>(memory + headerLength) : nullptr; }
@@ -0,0 +1,25 @@
+#ifndef PPM_WRITER__HXX
+#define PPM_WRITER__HXX
+
+#include "imageWriter.hxx"
+
+// Uncompressed binary PPM, pre-sized and mapped so the image can be rendered straight into it.
+struct ppmWriter_t final : public imageWriter_t
+{
+private:
+	int fd;
+	char *memory;
+	size_t length;
+	size_t headerLength;
+
+public:
+	constexpr ppmWriter_t() noexcept : fd{-1}, memory{nullptr}, length{0}, headerLength{0} { }
+	~ppmWriter_t() noexcept final override { close(); }
+
+	bool open(const area_t size, const char *const name) noexcept final override;
+	void close() noexcept final override;
+	void writeRow(const uint32_t row, const rgb8_t *const pixels, const uint32_t width) noexcept final override;
+	rgb8_t *pixels() const noexcept final override;
+};
+
+#endif /*PPM_WRITER__HXX*/
@@ -0,0 +1,96 @@
+#include <stdio.h>
+#include <string.h>
+#include <algorithm>
+#include "pyramid.hxx"
+#include "memory.hxx"
+
+// Rounds the sum of a 2x2 box of pixels to their average.
+inline rgb8_t average(const rgb16_t sum) noexcept
+	{ return {uint8_t((sum.r() + 2) / 4), uint8_t((sum.g() + 2) / 4), uint8_t((sum.b() + 2) / 4)}; }
+
+bool pyramid_t::open(const area_t size, const char *const name, const uint32_t count, const char *const format,
+	const uint32_t level) noexcept
+{
+	// Each level is half the size of the one above until the image is down to a single pixel.
+	uint32_t depth{0};
+	for (area_t levelSize{size}; depth < count && (levelSize.width() > 1 || levelSize.height() > 1); ++depth)
+		levelSize = {(levelSize.width() + 1) / 2, (levelSize.height() + 1) / 2};
+	width = size.width();
+	levels = fixedVector_t<pyramidLevel_t>{depth};
+	if (!depth)
+		return true;
+	else if (!levels.valid())
+		return false;
+
+	const size_t nameLength = strlen(name) + 12;
+	const auto levelName = makeUnique<char []>(nameLength);
+	if (!levelName)
+		return false;
+	area_t levelSize{size};
+	for (uint32_t i{0}; i < depth; ++i)
+	{
+		pyramidLevel_t &pyramidLevel = levels[i];
+		levelSize = {(levelSize.width() + 1) / 2, (levelSize.height() + 1) / 2};
+		pyramidLevel.size = levelSize;
+		pyramidLevel.sums = fixedVector_t<rgb16_t>{levelSize.width()};
+		pyramidLevel.row = fixedVector_t<rgb8_t>{levelSize.width()};
+		pyramidLevel.writer = makeImageWriter(format, level);
+		snprintf(levelName.get(), nameLength, "%s-%u", name, i + 1);
+		if (!pyramidLevel.sums.valid() || !pyramidLevel.row.valid() || !pyramidLevel.writer ||
+			!pyramidLevel.writer->open(levelSize, levelName.get()))
+			return false;
+	}
+	return true;
+}
+
+// Folds a row of the level above into a level - an image edge with an odd number of pixels
+// has its last pixel stand in for the missing one beside it.
+void pyramid_t::addRow(const uint32_t index, const rgb8_t *const pixels, const uint32_t aboveWidth) noexcept
+{
+	pyramidLevel_t &level = levels[index];
+	rgb16_t *const sums = level.sums.data();
+	rgb8_t *const row = level.row.data();
+	const bool second = level.rowsIn++ & 1;
+	for (uint32_t x{0}; x < level.size.width(); ++x)
+	{
+		const rgb16_t sum = rgb16_t{pixels[2 * x]} + rgb16_t{pixels[std::min(2 * x + 1, aboveWidth - 1)]};
+		if (second)
+			row[x] = average(sums[x] + sum);
+		else
+			sums[x] = sum;
+	}
+	if (second)
+		writeLevelRow(index);
+}
+
+void pyramid_t::writeLevelRow(const uint32_t index) noexcept
+{
+	pyramidLevel_t &level = levels[index];
+	level.writer->writeRow(level.rowsOut++, level.row.data(), level.size.width());
+	if (index + 1 < levels.count())
+		addRow(index + 1, level.row.data(), level.size.width());
+}
+
+void pyramid_t::writeRow(const rgb8_t *const pixels) noexcept
+{
+	if (levels.count())
+		addRow(0, pixels, width);
+}
+
+void pyramid_t::close() noexcept
+{
+	// An image with an odd number of rows leaves its last row unpaired, which then stands in for the missing one.
+	// Finishing a level can complete the one below, so the levels are finished top down.
+	for (uint32_t i{0}; i < levels.count(); ++i)
+	{
+		pyramidLevel_t &level = levels[i];
+		if (level.rowsIn & 1)
+		{
+			for (uint32_t x{0}; x < level.size.width(); ++x)
+				level.row[x] = average(level.sums[x] + level.sums[x]);
+			++level.rowsIn;
+			writeLevelRow(i);
+		}
+		level.writer->close();
+	}
+}
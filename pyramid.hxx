@@ -0,0 +1,48 @@
+#ifndef PYRAMID__HXX
+#define PYRAMID__HXX
+
+#include <stdint.h>
+#include <memory>
+#include "imageWriter.hxx"
+#include "fixedVector.hxx"
+
+// The most levels a pyramid can be asked for - enough to take any image down to a pixel.
+constexpr static const uint32_t maxPyramidLevels = 32;
+
+// One level of a pyramid, half the size of the level above rounded up. The rows from above arrive
+// in pairs - the first is held as the sums of its pixel pairs until the second completes the boxes.
+struct pyramidLevel_t final
+{
+	std::unique_ptr<imageWriter_t> writer;
+	area_t size;
+	fixedVector_t<rgb16_t> sums;
+	fixedVector_t<rgb8_t> row;
+	uint32_t rowsIn, rowsOut;
+
+	pyramidLevel_t() noexcept : writer{}, size{}, sums{}, row{}, rowsIn{0}, rowsOut{0} { }
+};
+
+// Successively 2x box filtered copies of an image, each written as its own image while the full
+// size one is. Rows are taken as the image is written, so no level needs more than a row held.
+struct pyramid_t final
+{
+private:
+	fixedVector_t<pyramidLevel_t> levels;
+	uint32_t width;
+
+	void addRow(const uint32_t index, const rgb8_t *const pixels, const uint32_t aboveWidth) noexcept;
+	void writeLevelRow(const uint32_t index) noexcept;
+
+public:
+	pyramid_t() noexcept : levels{}, width{0} { }
+
+	// Opens count levels below an image of the given size, as name-1 for the level at half size and on
+	// down - stopping early once a level is a single pixel. The levels are written in format at level.
+	bool open(const area_t size, const char *const name, const uint32_t count, const char *const format,
+		const uint32_t level) noexcept;
+	// Takes the rows of the full size image in order.
+	void writeRow(const rgb8_t *const pixels) noexcept;
+	void close() noexcept;
+};
+
+#endif /*PYRAMID__HXX*/
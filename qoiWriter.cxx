@@ -0,0 +1,110 @@
+#include <stdio.h>
+#include "qoiWriter.hxx"
+
+constexpr static const uint8_t qoiIndex = 0x00;
+constexpr static const uint8_t qoiDiff = 0x40;
+constexpr static const uint8_t qoiLuma = 0x80;
+constexpr static const uint8_t qoiRun = 0xC0;
+constexpr static const uint8_t qoiRGB = 0xFE;
+constexpr static const uint8_t qoiMaxRun = 62;
+constexpr static const std::array<uint8_t, 8> qoiEnd{{0, 0, 0, 0, 0, 0, 0, 1}};
+
+// Every pixel is opaque, so alpha contributes 255 * 11 to the hash.
+inline uint8_t qoiHash(const rgb8_t pixel) noexcept
+	{ return ((pixel.r() * 3) + (pixel.g() * 5) + (pixel.b() * 7) + (255 * 11)) % 64; }
+inline uint32_t qoiPack(const rgb8_t pixel) noexcept
+	{ return (uint32_t(pixel.r()) << 24) | (uint32_t(pixel.g()) << 16) | (uint32_t(pixel.b()) << 8) | 0xFF; }
+
+inline void writeBE(uint8_t *const data, const uint32_t value) noexcept
+{
+	data[0] = uint8_t(value >> 24);
+	data[1] = uint8_t(value >> 16);
+	data[2] = uint8_t(value >> 8);
+	data[3] = uint8_t(value);
+}
+
+bool qoiWriter_t::open(const area_t size, const char *const name) noexcept
+{
+	std::array<uint8_t, 14> header{{'q', 'o', 'i', 'f'}};
+	writeBE(&header[4], size.width());
+	writeBE(&header[8], size.height());
+	header[12] = 3; // RGB
+	header[13] = 0; // sRGB with linear alpha
+
+	// A pixel never needs more than a run and an RGB op to encode.
+	buffer = fixedVector_t<uint8_t>{(size_t(size.width()) * 4) + 1};
+	const auto fileName = imageFileName(name, "qoi");
+	if (!fileName || !buffer.valid())
+		return false;
+	file = fopen(fileName.get(), "wb");
+	if (!file.valid())
+		return false;
+	index.fill(0);
+	previous = {};
+	run = 0;
+	return fwrite(header.data(), header.size(), 1, file) == 1;
+}
+
+void qoiWriter_t::close() noexcept
+{
+	if (run)
+		fputc(qoiRun | (run - 1), file);
+	run = 0;
+	fwrite(qoiEnd.data(), qoiEnd.size(), 1, file);
+	file.close();
+}
+
+void qoiWriter_t::writeRow(const uint32_t, const rgb8_t *const pixels, const uint32_t width) noexcept
+{
+	uint8_t *const data = buffer.data();
+	size_t length = 0;
+	for (uint32_t x{0}; x < width; ++x)
+	{
+		const rgb8_t pixel = pixels[x];
+		if (qoiPack(pixel) == qoiPack(previous))
+		{
+			if (++run == qoiMaxRun)
+			{
+				data[length++] = qoiRun | (run - 1);
+				run = 0;
+			}
+			continue;
+		}
+		else if (run)
+		{
+			data[length++] = qoiRun | (run - 1);
+			run = 0;
+		}
+
+		const uint8_t hash = qoiHash(pixel);
+		if (index[hash] == qoiPack(pixel))
+			data[length++] = qoiIndex | hash;
+		else
+		{
+			index[hash] = qoiPack(pixel);
+			const int8_t r = int8_t(pixel.r() - previous.r());
+			const int8_t g = int8_t(pixel.g() - previous.g());
+			const int8_t b = int8_t(pixel.b() - previous.b());
+			const int8_t rg = int8_t(r - g);
+			const int8_t bg = int8_t(b - g);
+
+			if (r >= -2 && r <= 1 && g >= -2 && g <= 1 && b >= -2 && b <= 1)
+				data[length++] = qoiDiff | ((r + 2) << 4) | ((g + 2) << 2) | (b + 2);
+			else if (g >= -32 && g <= 31 && rg >= -8 && rg <= 7 && bg >= -8 && bg <= 7)
+			{
+				data[length++] = qoiLuma | (g + 32);
+				data[length++] = ((rg + 8) << 4) | (bg + 8);
+			}
+			else
+			{
+				data[length++] = qoiRGB;
+				data[length++] = pixel.r();
+				data[length++] = pixel.g();
+				data[length++] = pixel.b();
+			}
+		}
+		previous = pixel;
+	}
+	if (length)
+		fwrite(data, length, 1, file);
+}
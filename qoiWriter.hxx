@@ -0,0 +1,28 @@
+#ifndef QOI_WRITER__HXX
+#define QOI_WRITER__HXX
+
+#include <array>
+#include "imageWriter.hxx"
+#include "file.hxx"
+#include "fixedVector.hxx"
+
+// The "Quite OK Image" format - lossless like PNG, but encodes in a single cheap pass.
+struct qoiWriter_t final : public imageWriter_t
+{
+private:
+	file_t file;
+	// Packed RGBA, so unused entries (which are transparent) never match a pixel.
+	std::array<uint32_t, 64> index;
+	rgb8_t previous;
+	uint8_t run;
+	fixedVector_t<uint8_t> buffer;
+
+public:
+	qoiWriter_t() noexcept : file{}, index{}, previous{}, run{0}, buffer{} { }
+
+	bool open(const area_t size, const char *const name) noexcept final override;
+	void close() noexcept final override;
+	void writeRow(const uint32_t row, const rgb8_t *const pixels, const uint32_t width) noexcept final override;
+};
+
+#endif /*QOI_WRITER__HXX*/
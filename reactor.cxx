@@ -0,0 +1,228 @@
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <unistd.h>
+#include <errno.h>
+#include <stdio.h>
+#include <string.h>
+#include "reactor.hxx"
+#include "shader.hxx"
+#include "memory.hxx"
+#include "escapeCodec.hxx"
+
+constexpr static const uint32_t listenToken = UINT32_MAX;
+constexpr static const uint32_t wakeToken = UINT32_MAX - 1;
+
+struct shadeConnection_t final
+{
+	socketStream_t stream;
+	tile_t tile;
+	uint32_t row;
+	size_t received;
+	// Only used when compute sends escape values - each row is its encoded length then the encoded values.
+	escapeCodec_t codec;
+	bool haveLength;
+	uint32_t length;
+	fixedVector_t<uint8_t> packet;
+	fixedVector_t<uint32_t> values;
+	fixedVector_t<rgb8_t> points;
+
+	shadeConnection_t(socketStream_t &&_stream, const tile_t _tile, const uint32_t subdiv) noexcept :
+		stream{std::move(_stream)}, tile{_tile}, row{0}, received{0}, codec{tile.size.width(), subdiv},
+		haveLength{false}, length{0}, packet{subdiv ? codec.maxLength() : 0},
+		values{size_t(tile.size.width()) * subdiv * subdiv}, points{subdiv * subdiv} { }
+
+	bool valid() const noexcept
+		{ return !points.count() || (codec.valid() && packet.valid() && values.valid() && points.valid()); }
+};
+
+shadeReactor_t::shadeReactor_t(const socketStream_t &_listener, const area_t _size,
+	const fixedVector_t<tile_t> &_tiles, const uint64_t _maxIterations, const uint32_t _subdiv) noexcept :
+	listener{_listener}, connectionCount(_tiles.count()), size{_size}, tiles{_tiles},
+	maxIterations{_maxIterations}, subdiv{_subdiv}, epoll{epoll_create1(EPOLL_CLOEXEC)}, wake{eventfd(0, EFD_CLOEXEC)}, accepted{0},
+	remaining{connectionCount}, connections{makeUnique<std::unique_ptr<shadeConnection_t> []>(connectionCount)},
+	threads{}, threadCount{0} { }
+
+shadeReactor_t::~shadeReactor_t() noexcept
+{
+	if (wake != -1)
+		close(wake);
+	if (epoll != -1)
+		close(epoll);
+}
+
+bool shadeReactor_t::watch(const int fd, const uint32_t token, const bool add) const noexcept
+{
+	epoll_event event{};
+	// One shot, so only one thread at a time ever handles a given connection.
+	event.events = EPOLLIN | EPOLLONESHOT;
+	event.data.u32 = token;
+	return epoll_ctl(epoll, add ? EPOLL_CTL_ADD : EPOLL_CTL_MOD, fd, &event) == 0;
+}
+
+bool shadeReactor_t::start(const uint32_t count) noexcept
+{
+	epoll_event event{};
+	event.events = EPOLLIN;
+	event.data.u32 = wakeToken;
+	threads = makeUnique<std::thread []>(count);
+	if (epoll == -1 || wake == -1 || !connections || !threads ||
+		epoll_ctl(epoll, EPOLL_CTL_ADD, wake, &event) ||
+		!watch(listener.socket(), listenToken, true))
+		return false;
+
+	printf("Launching %u shader threads for %u connections\n", count, connectionCount);
+	for (threadCount = 0; threadCount < count; ++threadCount)
+		threads[threadCount] = std::thread([this](const uint32_t affinityOffset) noexcept
+			{ run(affinityOffset); }, threadCount);
+	return true;
+}
+
+void shadeReactor_t::join() noexcept
+{
+	for (uint32_t i{0}; i < threadCount; ++i)
+		threads[i].join();
+	threadCount = 0;
+}
+
+void shadeReactor_t::run(const uint32_t affinityOffset) noexcept
+{
+	threadAffinity(affinityOffset);
+	epoll_event event{};
+	while (remaining)
+	{
+		const int result = epoll_wait(epoll, &event, 1, -1);
+		if (result < 0 && errno != EINTR)
+		{
+			perror("Failed waiting for connections");
+			abort();
+		}
+		else if (result < 1)
+			continue;
+
+		const uint32_t token = event.data.u32;
+		if (token == wakeToken)
+			break;
+		else if (token == listenToken)
+		{
+			if (!accept())
+				abort();
+		}
+		else if (receive(*connections[token]))
+		{
+			if (!watch(connections[token]->stream.socket(), token, false))
+				abort();
+		}
+		else
+			finish(token);
+	}
+}
+
+bool shadeReactor_t::accept() noexcept
+{
+	socketStream_t stream = listener.accept();
+	if (!stream.valid())
+	{
+		puts("Failed to aquire socket for incomming connection");
+		return false;
+	}
+
+	const uint32_t index = accepted++;
+	const tile_t tile = tiles.data()[index];
+	// Sent while the socket is still blocking - they're the only things we ever send.
+	if (!write(stream, tile) || !write(stream, maxIterations) || !stream.socket().blocking(false))
+	{
+		puts("Failed to send the tile to compute");
+		return false;
+	}
+	printf("Shader receiving %u by %u at %u, %u\n", tile.size.width(), tile.size.height(),
+		tile.offset.width(), tile.offset.height());
+
+	connections[index] = makeUnique<shadeConnection_t>(std::move(stream), tile, subdiv);
+	if (!connections[index] || !connections[index]->valid() ||
+		!watch(connections[index]->stream.socket(), index, true))
+		return false;
+	return accepted == connectionCount || watch(listener.socket(), listenToken, false);
+}
+
+// Reads into buffer until length bytes have arrived, returning false if the socket runs dry first.
+bool shadeReactor_t::fill(shadeConnection_t &connection, void *const buffer, const size_t length) const noexcept
+{
+	while (connection.received < length)
+	{
+		const ssize_t result = connection.stream.socket().read(static_cast<char *>(buffer) + connection.received,
+			length - connection.received);
+		if (result < 0 && (errno == EAGAIN || errno == EWOULDBLOCK))
+			return false;
+		else if (result < 0 && errno == EINTR)
+			continue;
+		else if (result <= 0)
+		{
+			const area_t pixel = connection.tile.offset + area_t{0, connection.row};
+			printf("Aborting at %u, %u - %s\n", pixel.width(), pixel.height(),
+				result ? strerror(errno) : "connection closed");
+			fflush(stdout);
+			abort();
+		}
+		connection.received += size_t(result);
+	}
+	connection.received = 0;
+	return true;
+}
+
+// Reads and shades the next row of escape values, returning false if it hasn't all arrived yet.
+bool shadeReactor_t::receiveValues(shadeConnection_t &connection, rgb8_t *const pixels) const noexcept
+{
+	if (!connection.haveLength)
+	{
+		if (!fill(connection, &connection.length, sizeof(uint32_t)))
+			return false;
+		connection.haveLength = true;
+		if (connection.length > connection.packet.count())
+		{
+			printf("Aborting at row %u - escape values too long\n", connection.row);
+			fflush(stdout);
+			abort();
+		}
+	}
+	if (!fill(connection, connection.packet.data(), connection.length))
+		return false;
+	connection.haveLength = false;
+	if (!connection.codec.decode(connection.packet.data(), connection.length, connection.values.data()))
+	{
+		printf("Aborting at row %u - malformed escape values\n", connection.row);
+		fflush(stdout);
+		abort();
+	}
+	shadeValues(connection.values.data(), connection.tile.size.width(), connection.points, pixels);
+	return true;
+}
+
+// Reads everything available on a connection, returning false once its tile is complete.
+bool shadeReactor_t::receive(shadeConnection_t &connection) noexcept
+{
+	const tile_t &tile = connection.tile;
+	const size_t rowLength = sizeof(rgb8_t) * tile.size.width();
+	while (connection.row < tile.size.height())
+	{
+		const area_t pixel = tile.offset + area_t{0, connection.row};
+		rgb8_t *const pixels = &image[(pixel.height() * size_t(size.width())) + pixel.width()];
+		if (subdiv ? !receiveValues(connection, pixels) : !fill(connection, pixels, rowLength))
+			return true;
+		++connection.row;
+		if (++imageStatus[pixel.height()] == xTiles)
+			completedRows.push(pixel.height());
+	}
+	return false;
+}
+
+void shadeReactor_t::finish(const uint32_t index) noexcept
+{
+	connections[index].reset();
+	// Wake every thread once all the subchunks are in - the event stays readable.
+	if (--remaining == 0)
+	{
+		const uint64_t value = 1;
+		if (::write(wake, &value, sizeof(value)) != sizeof(value))
+			abort();
+	}
+}
@@ -0,0 +1,56 @@
+#ifndef REACTOR__HXX
+#define REACTOR__HXX
+
+#include <stdint.h>
+#include <atomic>
+#include <memory>
+#include <thread>
+#include "mandelbrot.hxx"
+#include "shader.hxx"
+#include "socket.hxx"
+#include "fixedVector.hxx"
+
+struct shadeConnection_t;
+
+// Accepts the compute processes' connections, hands each a tile and receives the tiles straight
+// into the image, with a small pool of threads draining whichever connections have data as it arrives.
+struct shadeReactor_t final
+{
+private:
+	const socketStream_t &listener;
+	const uint32_t connectionCount;
+	const area_t size;
+	// Already trimmed of any rows recovered from the journal.
+	const fixedVector_t<tile_t> &tiles;
+	const uint64_t maxIterations;
+	// The subdivisions per pixel when compute sends escape values, 0 when it sends pixels.
+	const uint32_t subdiv;
+	int epoll, wake;
+	uint32_t accepted;
+	std::atomic<uint32_t> remaining;
+	std::unique_ptr<std::unique_ptr<shadeConnection_t> []> connections;
+	std::unique_ptr<std::thread []> threads;
+	uint32_t threadCount;
+
+	void run(const uint32_t affinityOffset) noexcept;
+	bool accept() noexcept;
+	bool fill(shadeConnection_t &connection, void *const buffer, const size_t length) const noexcept;
+	bool receiveValues(shadeConnection_t &connection, rgb8_t *const pixels) const noexcept;
+	bool receive(shadeConnection_t &connection) noexcept;
+	void finish(const uint32_t index) noexcept;
+	bool watch(const int fd, const uint32_t token, const bool add) const noexcept;
+
+public:
+	shadeReactor_t(const socketStream_t &_listener, const area_t _size, const fixedVector_t<tile_t> &_tiles,
+		const uint64_t _maxIterations, const uint32_t _subdiv) noexcept;
+	shadeReactor_t(const shadeReactor_t &) = delete;
+	shadeReactor_t(shadeReactor_t &&) = delete;
+	~shadeReactor_t() noexcept;
+	shadeReactor_t &operator =(const shadeReactor_t &) = delete;
+	shadeReactor_t &operator =(shadeReactor_t &&) = delete;
+
+	bool start(const uint32_t threads) noexcept;
+	void join() noexcept;
+};
+
+#endif /*REACTOR__HXX*/
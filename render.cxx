@@ -0,0 +1,400 @@
+#include <math.h>
+#include <fenv.h>
+#include <algorithm>
+#include "render.hxx"
+#include "memory.hxx"
+
+static const double log_2 = log(2);
+// The points probed when picking the iteration limit form a grid this many a side over the view,
+// however large the image - so neither the limit picked nor the time taken to pick it grows with it.
+constexpr static const uint32_t probeGrid = 64;
+// The limit is raised while more than 1/lateShare of the probes escape in the last 1/autoTail of it.
+constexpr static const uint32_t lateShare = 1024;
+constexpr static const uint64_t autoTail = 4;
+constexpr static const uint64_t maxAutoIterations = uint64_t(1) << 26;
+// How far in samples the real axis may sit from a row or half-row and still be mirrored about - well
+// under anything visible, but enough to absorb the rounding in working out where the axis lies.
+constexpr static const double mirrorTolerance = 1e-6;
+
+point2_t renderScale(const renderRequest_t &request) noexcept
+{
+	const area_t size = request.size;
+	const double base = std::min(size.width(), size.height()) / (2.0 / request.zoom);
+	const point2_t region{size.width() / base, size.height() / base};
+	return size / region;
+}
+
+point2_t renderOrigin(const renderRequest_t &request, const point2_t scale) noexcept
+	{ return -((request.size / scale) / 2) + request.center; }
+
+double computePoint(const point2_t p0, const uint64_t limit, const double bailout) noexcept
+{
+	point2_t pp, p{};
+	uint64_t iteration{0};
+
+	for (; iteration < limit; ++iteration)
+	{
+		pp = p * p;
+		if (pp.sum() > bailout)
+			break;
+		p.y(2 * p.mul() + p0.y());
+		p.x(pp.diff() + p0.x());
+	}
+
+	if (iteration == limit)
+		return interiorPoint;
+	else if (iteration)
+	{
+		pp = p * p;
+		const double zn = log(pp.sum()) / 2;
+		const double nu = log(zn / log_2) / log_2;
+		feclearexcept(FE_ALL_EXCEPT);
+		return iteration + 1 - nu;
+	}
+	return iteration;
+}
+
+// Picks the iteration limit for the view. With autoIterations, the probe grid is run with doubling
+// limits until hardly any of it escapes in the last quarter of the limit - if next to nothing escapes
+// that late, the points still going at the end are very likely interior. A few points on the set's
+// edge always escape late whatever the limit, so it's a share of the grid rather than any point at
+// all. The grid's rows are spread over threads threads.
+uint64_t viewIterations(const renderRequest_t &request, const uint32_t threads) noexcept
+{
+	if (!request.autoIterations || !request.size.width() || !request.size.height())
+		return request.maxIterations;
+	const point2_t scale = renderScale(request);
+	const point2_t origin = renderOrigin(request, scale);
+	const point2_t step = (request.size / scale) / probeGrid;
+	const double bailout = request.bailout * request.bailout;
+	const uint32_t lateProbes = (probeGrid * probeGrid) / lateShare;
+	const uint32_t threadCount = std::max<uint32_t>(threads, 1);
+	auto workers = makeUnique<std::thread []>(threadCount);
+	uint64_t limit = request.maxIterations;
+	for (bool escapedLate{true}; escapedLate && limit < maxAutoIterations; )
+	{
+		std::atomic<uint32_t> nextRow{0}, late{0};
+		const auto probe = [&]() noexcept
+		{
+			for (uint32_t y = nextRow++; y < probeGrid && late <= lateProbes; y = nextRow++)
+			{
+				for (uint32_t x{0}; x < probeGrid; ++x)
+				{
+					const double iteration = computePoint(origin + (step * point2_t{x + 0.5, y + 0.5}), limit, bailout);
+					if (iteration != interiorPoint && iteration > limit - (limit / autoTail))
+						++late;
+				}
+			}
+		};
+		if (workers && threadCount > 1)
+		{
+			for (uint32_t i{0}; i < threadCount; ++i)
+				workers[i] = std::thread(probe);
+			for (uint32_t i{0}; i < threadCount; ++i)
+				workers[i].join();
+		}
+		else
+			probe();
+		escapedLate = late > lateProbes;
+		if (escapedLate)
+			limit *= 2;
+	}
+	return limit;
+}
+
+// The set is symmetric about the real axis, so if the supersampled grid is too then sample row r
+// (counted up from the bottom of the image) has the same value as sample row axis - r. That's so
+// whenever the real axis lies on a sample row or halfway between two.
+// Returns the axis for the grid, or 0 if the grid does not map onto itself.
+int64_t mirrorAxis(const renderRequest_t &request) noexcept
+{
+	const uint32_t subdiv = request.subdiv;
+	const double shift = 2 * subdiv * request.center.y() * renderScale(request).y();
+	if (fabs(shift - nearbyint(shift)) > mirrorTolerance)
+		return 0;
+	return (2 * int64_t(subdiv / 2)) + (int64_t(subdiv) * request.size.height()) - int64_t(nearbyint(shift));
+}
+
+// The rows handed out together - either one row, or a band of rows above the real axis along with
+// the rows below it that mirror them, which copy the band's samples rather than computing their own.
+struct renderUnit_t final
+{
+	uint32_t first, count;
+	bool mirrored;
+};
+
+// How many rows above the axis a mirrored unit holds. Unless the axis lies on a pixel boundary, the
+// rows mirroring a band also take a sample row from the row past its end, which has to be computed
+// again, so bigger bands do less twice - at the cost of keeping all the band's samples meanwhile.
+constexpr static const uint32_t mirrorBand = 8;
+
+struct renderJob_t final
+{
+	const renderRequest_t &request;
+	rgb8_t *const pixels;
+	const rowCallback_t &rowDone;
+	const point2_t scale;
+	// Picked for the whole image, even when resuming part way, so no rows differ from the rest.
+	const uint64_t limit;
+	// Where each subpixel's sample sits relative to its pixel.
+	fixedVector_t<point2_t> samples;
+	// Sample row r mirrors sample row axis - r, and image row y above the axis pairs with pairSum - y.
+	const int64_t axis;
+	int64_t pairSum;
+	fixedVector_t<renderUnit_t> units;
+	uint32_t unitCount, nextUnit, remaining;
+	bool failed;
+	renderJob_t *next;
+
+	renderJob_t(const renderRequest_t &_request, rgb8_t *const _pixels, const rowCallback_t &_rowDone,
+		const uint64_t _limit) noexcept :
+		request{_request}, pixels{_pixels}, rowDone{_rowDone}, scale{renderScale(request)},
+		limit{_limit},
+		samples{size_t(request.subdiv) * request.subdiv}, axis{mirrorAxis(request)}, pairSum{0},
+		units{request.size.height()}, unitCount{0}, nextUnit{0}, remaining{0}, failed{false}, next{nullptr}
+	{
+		if (!samples.valid() || !units.valid())
+			return;
+		const uint32_t subdiv = request.subdiv;
+		const point2_t origin = renderOrigin(request, scale);
+		const point2_t subpixelOrigin = -(point2_t{double(subdiv / 2), double(subdiv / 2)} / subdiv) / scale;
+		const point2_t subpixelOffset = (point2_t{1, 1} / subdiv) / scale;
+		for (uint32_t y{0}; y < subdiv; ++y)
+		{
+			for (uint32_t x{0}; x < subdiv; ++x)
+				samples[x + (y * subdiv)] = origin + ((subpixelOffset * area_t{x, y}) + subpixelOrigin);
+		}
+		planUnits();
+	}
+
+	bool done(const int64_t y) const noexcept { return request.doneRows && request.doneRows[y]; }
+
+	// Works out which rows pair up across the axis - y in [bandStart, bandEnd) with pairSum - y below
+	// it, so long as neither is done already - and splits the rest still to render into single rows.
+	void planUnits() noexcept
+	{
+		const uint32_t subdiv = request.subdiv;
+		const int64_t height = request.size.height();
+		int64_t bandStart{0}, bandEnd{0};
+		if (axis)
+		{
+			const int64_t axisRow = axis >= 0 ? axis / subdiv : -((subdiv - 1 - axis) / subdiv);
+			pairSum = (2 * (height - 1)) - axisRow;
+			bandStart = std::max<int64_t>(0, pairSum - (height - 1));
+			bandEnd = pairSum > 0 ? std::min((pairSum + 1) / 2, height) : 0;
+		}
+		const auto paired = [&](const int64_t y) noexcept
+			{ return y >= bandStart && y < bandEnd && !done(y) && !done(pairSum - y); };
+
+		for (int64_t y{0}; y < height; )
+		{
+			if (paired(y))
+			{
+				uint32_t count{1};
+				while (count < mirrorBand && paired(y + count))
+					++count;
+				units[unitCount++] = {uint32_t(y), count, true};
+				remaining += 2 * count;
+				y += count;
+			}
+			else
+			{
+				if (!done(y) && !paired(pairSum - y))
+				{
+					units[unitCount++] = {uint32_t(y), 1, false};
+					++remaining;
+				}
+				++y;
+			}
+		}
+	}
+
+	// The sample row whose value sample row r takes - its mirror when that lies above it in the image,
+	// so the rows below the axis come out the same whether or not their samples are copied.
+	int64_t sampleSource(const int64_t r) const noexcept
+	{
+		const int64_t mirror = axis - r;
+		return axis && mirror > r && mirror < int64_t(request.size.height()) * request.subdiv ? mirror : r;
+	}
+
+	bool valid() const noexcept { return samples.valid() && units.valid(); }
+};
+
+// A mirrored unit's band of rows, keeping every sample computed for them so that the rows mirroring
+// them can copy theirs.
+struct sampleBand_t final
+{
+	uint32_t first, count;
+	rgb8_t *samples;
+
+	bool holds(const uint32_t y) const noexcept { return samples && y >= first && y - first < count; }
+};
+
+void renderRow(const renderJob_t &job, const uint32_t y, fixedVector_t<rgb8_t> &points, const sampleBand_t &band) noexcept
+{
+	const renderRequest_t &request = job.request;
+	const double bailout = request.bailout * request.bailout;
+	const uint32_t width = request.size.width();
+	const uint32_t maxY = request.size.height() - 1;
+	const uint32_t subdiv = request.subdiv;
+	const size_t sampleCount = points.count();
+	rgb8_t *const kept = band.holds(y) ? band.samples + (size_t(y - band.first) * width * sampleCount) : nullptr;
+
+	rgb8_t *const row = job.pixels + (size_t(y) * width);
+	for (uint32_t x{0}; x < width; ++x)
+	{
+		for (uint32_t sy{0}; sy < subdiv; ++sy)
+		{
+			const int64_t source = job.sampleSource((int64_t(maxY - y) * subdiv) + sy);
+			const uint32_t sourceY = maxY - uint32_t(source / subdiv);
+			const uint32_t sourceRow = uint32_t(source % subdiv);
+			const point2_t pixel = area_t{x, maxY - sourceY} / job.scale;
+			const rgb8_t *const copy = !kept && band.holds(sourceY) ?
+				band.samples + (((size_t(sourceY - band.first) * width) + x) * sampleCount) : nullptr;
+			for (uint32_t sx{0}; sx < subdiv; ++sx)
+			{
+				const uint32_t i = sx + (sourceRow * subdiv);
+				points[sx + (sy * subdiv)] = copy ? copy[i] : shade(computePoint(pixel + job.samples[i], job.limit, bailout));
+			}
+		}
+		if (kept)
+			std::copy(points.data(), points.data() + sampleCount, kept + (x * sampleCount));
+		row[x] = shadePixel(points);
+	}
+}
+
+// Renders a unit's rows, counting each done as it's finished.
+void renderPool_t::renderUnit(renderJob_t &job, const renderUnit_t &unit) noexcept
+{
+	const size_t sampleCount = job.samples.count();
+	const int64_t pairSum = job.pairSum;
+	fixedVector_t<rgb8_t> points{sampleCount};
+	fixedVector_t<rgb8_t> samples{unit.mirrored ? size_t(unit.count) * job.request.size.width() * sampleCount : 0};
+	const bool rendered = points.valid() && (!unit.mirrored || samples.valid());
+	const sampleBand_t band{unit.first, unit.count, samples.data()};
+
+	for (uint32_t i{0}; i < unit.count; ++i)
+	{
+		if (rendered)
+			renderRow(job, unit.first + i, points, band);
+		complete(job, unit.first + i, rendered);
+	}
+	if (!unit.mirrored)
+		return;
+	for (uint32_t i{0}; i < unit.count; ++i)
+	{
+		const uint32_t y = uint32_t(pairSum - (unit.first + i));
+		if (rendered)
+			renderRow(job, y, points, band);
+		complete(job, y, rendered);
+	}
+}
+
+renderPool_t::renderPool_t(const uint32_t count) noexcept : poolMutex{}, poolCond{}, doneCond{},
+	jobs{nullptr}, stopping{false}, threads{makeUnique<std::thread []>(count)}, threadCount{0}
+{
+	if (!threads)
+		return;
+	for (; threadCount < count; ++threadCount)
+		threads[threadCount] = std::thread([this]() noexcept { run(); });
+}
+
+renderPool_t::~renderPool_t() noexcept
+{
+	{
+		std::lock_guard<std::mutex> lock{poolMutex};
+		stopping = true;
+	}
+	poolCond.notify_all();
+	for (uint32_t i{0}; i < threadCount; ++i)
+		threads[i].join();
+}
+
+void renderPool_t::run() noexcept
+{
+	renderJob_t *job{nullptr};
+	renderUnit_t unit{};
+	while (next(job, unit, nullptr))
+		renderUnit(*job, unit);
+}
+
+// Takes a job off the list once all its rows have been handed out - called with the lock held.
+void renderPool_t::unlink(const renderJob_t &job) noexcept
+{
+	for (renderJob_t **entry = &jobs; *entry; entry = &(*entry)->next)
+	{
+		if (*entry == &job)
+		{
+			*entry = job.next;
+			break;
+		}
+	}
+}
+
+// Hands out the next rows to render - of only if given, else of the oldest job, waiting for one.
+bool renderPool_t::next(renderJob_t *&job, renderUnit_t &unit, renderJob_t *const only) noexcept
+{
+	std::unique_lock<std::mutex> lock{poolMutex};
+	if (only)
+	{
+		if (only->nextUnit == only->unitCount)
+			return false;
+		job = only;
+	}
+	else
+	{
+		poolCond.wait(lock, [&]() noexcept { return stopping || jobs; });
+		if (!jobs)
+			return false;
+		job = jobs;
+	}
+
+	unit = job->units[job->nextUnit++];
+	if (job->nextUnit == job->unitCount)
+		unlink(*job);
+	return true;
+}
+
+void renderPool_t::complete(renderJob_t &job, const uint32_t row, const bool rendered) noexcept
+{
+	if (rendered && job.rowDone)
+		job.rowDone(row);
+	// The job belongs to its render call, which can return the moment the last row is counted.
+	std::lock_guard<std::mutex> lock{poolMutex};
+	job.failed |= !rendered;
+	if (!--job.remaining)
+		doneCond.notify_all();
+}
+
+bool renderPool_t::render(const renderRequest_t &request, rgb8_t *const pixels, const rowCallback_t &rowDone) noexcept
+{
+	if (!pixels || !request.subdiv || !request.size.width())
+		return false;
+	else if (!request.size.height())
+		return true;
+	// This thread and the pool's between them probe for the limit, as they'd otherwise sit idle.
+	renderJob_t job{request, pixels, rowDone, viewIterations(request, threadCount + 1)};
+	if (!job.valid())
+		return false;
+	else if (!job.remaining)
+		return true;
+
+	{
+		std::lock_guard<std::mutex> lock{poolMutex};
+		renderJob_t **entry = &jobs;
+		while (*entry)
+			entry = &(*entry)->next;
+		*entry = &job;
+	}
+	poolCond.notify_all();
+
+	// Work on our own rows rather than waiting idle, so a render makes progress even on an empty pool.
+	renderJob_t *claimed{nullptr};
+	renderUnit_t unit{};
+	while (next(claimed, unit, &job))
+		renderUnit(job, unit);
+
+	std::unique_lock<std::mutex> lock{poolMutex};
+	doneCond.wait(lock, [&]() noexcept { return !job.remaining; });
+	return !job.failed;
+}
@@ -0,0 +1,87 @@
+#ifndef RENDER__HXX
+#define RENDER__HXX
+
+#include <stdint.h>
+#include <limits>
+#include <atomic>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <memory>
+#include <thread>
+#include "geometry.hxx"
+#include "shade.hxx"
+
+// Everything a render needs, so renders share nothing but the pool they run on.
+struct renderRequest_t final
+{
+	area_t size;
+	uint32_t subdiv;
+	point2_t center;
+	double zoom;
+	// With autoIterations, maxIterations is only where the limit starts before it's raised as the view needs.
+	uint64_t maxIterations;
+	bool autoIterations;
+	// The escape radius.
+	double bailout;
+	// One flag per row, with the rows flagged left as they are, having already been rendered - or
+	// nullptr to render every row.
+	const bool *doneRows;
+};
+
+// What computePoint() gives for points that never escaped within the iteration limit.
+constexpr static const double interiorPoint = std::numeric_limits<double>::infinity();
+
+// Called on the thread that finished it as each row of a render is completed.
+using rowCallback_t = std::function<void (const uint32_t row)>;
+
+struct renderJob_t;
+struct renderUnit_t;
+
+// Threads shared by every render given to them. Renders are split into rows - those mirroring each
+// other about the real axis handed out together - and the threads take rows from whichever renders
+// are in progress while each rendering thread works on its own too.
+struct renderPool_t final
+{
+private:
+	std::mutex poolMutex;
+	std::condition_variable poolCond, doneCond;
+	renderJob_t *jobs;
+	bool stopping;
+	std::unique_ptr<std::thread []> threads;
+	uint32_t threadCount;
+
+	void run() noexcept;
+	void unlink(const renderJob_t &job) noexcept;
+	bool next(renderJob_t *&job, renderUnit_t &unit, renderJob_t *const only) noexcept;
+	void renderUnit(renderJob_t &job, const renderUnit_t &unit) noexcept;
+	void complete(renderJob_t &job, const uint32_t row, const bool rendered) noexcept;
+
+public:
+	renderPool_t(const uint32_t threads) noexcept;
+	renderPool_t(const renderPool_t &) = delete;
+	renderPool_t(renderPool_t &&) = delete;
+	~renderPool_t() noexcept;
+	renderPool_t &operator =(const renderPool_t &) = delete;
+	renderPool_t &operator =(renderPool_t &&) = delete;
+
+	bool valid() const noexcept { return bool(threads); }
+	bool render(const renderRequest_t &request, rgb8_t *const pixels, const rowCallback_t &rowDone = {}) noexcept;
+};
+
+// Renders request into pixels, which must hold size.width() by size.height() pixels, returning
+// once it's complete. Safe to call from any number of threads at once, on the same pool or not.
+inline bool render(renderPool_t &pool, const renderRequest_t &request, rgb8_t *const pixels,
+	const rowCallback_t &rowDone = {}) noexcept
+	{ return pool.render(request, pixels, rowDone); }
+
+// The pieces renders are built from, for callers that split up the work themselves.
+point2_t renderScale(const renderRequest_t &request) noexcept;
+point2_t renderOrigin(const renderRequest_t &request, const point2_t scale) noexcept;
+// bailout is the square of the escape radius.
+double computePoint(const point2_t p0, const uint64_t limit, const double bailout) noexcept;
+// The iteration limit to render the view with, probing it on up to threads threads with autoIterations.
+uint64_t viewIterations(const renderRequest_t &request, const uint32_t threads) noexcept;
+int64_t mirrorAxis(const renderRequest_t &request) noexcept;
+
+#endif /*RENDER__HXX*/
@@ -1,11 +1,9 @@
 #include <array>
 #include <math.h>
-#include <string.h>
-#include "mandelbrot.hxx"
 #include "shade.hxx"
+#include "render.hxx"
 
-std::unique_ptr<rgb8_t []> image{nullptr};
-std::array<floatRGB_t, 16> colours
+const std::array<floatRGB_t, 16> colours
 {{
 	rgb8_t{0x07, 0x00, 0x5D},
 	rgb8_t{0x11, 0x19, 0x87},
@@ -25,10 +23,6 @@ std::array<floatRGB_t, 16> colours
 	rgb8_t{0x05, 0x00, 0x47}
 }};
 
-std::unique_ptr<std::atomic<uint32_t> []> imageStatus{nullptr};
-std::mutex imageMutex;
-std::condition_variable imageSync;
-
 inline floatRGB_t linearEase(const floatRGB_t &a, const floatRGB_t &b, const double amount) noexcept
 	{ return a + (b * amount); }
 
@@ -45,18 +39,11 @@ rgb8_t colourFor(const double x) noexcept
 
 rgb8_t shade(const double i) noexcept
 {
-	if (i >= maxIterations)
+	if (i == interiorPoint)
 		return {};
 	return colourFor(i / 6.0);
 }
 
-inline size_t xy(const area_t point, const area_t &size) noexcept
-{
-	size_t x = point.width();
-	size_t y = point.height() * size.width();
-	return y + x;
-}
-
 rgb8_t shadePixel(const fixedVector_t<rgb8_t> &points) noexcept
 {
 	floatRGB_t colour{};
@@ -65,33 +52,3 @@ rgb8_t shadePixel(const fixedVector_t<rgb8_t> &points) noexcept
 	colour /= points.count();
 	return colour.toRGB8();
 }
-
-void shadeChunk(const area_t size, const area_t subchunk, const uint32_t /*subdiv*/,
-	stream_t &stream, const uint32_t affinityOffset) noexcept
-{
-	area_t offset;
-	if (!image)
-		return;
-	threadAffinity(affinityOffset);
-	if (!stream.read(offset))
-		abort();
-	offset *= subchunk;
-
-	printf("Shader launched for %u, %u\n", offset.width(), offset.height());
-	for (uint32_t y{0}; y < subchunk.height(); ++y)
-	{
-		for (uint32_t x{0}; x < subchunk.width(); ++x)
-		{
-			if (!read(stream, image[xy(area_t{x, y} + offset, size)]))
-			{
-				printf("Aborting at %u, %u - %s\n", x, y, strerror(errno));
-				fflush(stdout);
-				abort();
-			}
-		}
-		++imageStatus[y + offset.height()];
-		if (imageStatus[y + offset.height()] == xTiles)
-			imageSync.notify_all();
-	}
-	puts("Shader done");
-}
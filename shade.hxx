@@ -2,12 +2,11 @@
 #define SHADE__HXX
 
 #include <stdint.h>
+#include <algorithm>
+#include <limits>
 #include <type_traits>
 #include <memory>
-#include <atomic>
-#include <mutex>
-#include <condition_variable>
-#include "mandelbrot.hxx"
+#include "fixedVector.hxx"
 
 struct floatRGB_t;
 
@@ -109,15 +108,7 @@ public:
 	}
 };
 
-extern std::unique_ptr<rgb8_t []> image;
-extern std::unique_ptr<std::atomic<uint32_t> []> imageStatus;
-extern std::mutex imageMutex;
-extern std::condition_variable imageSync;
-extern uint32_t xTiles;
-
 rgb8_t shade(const double i) noexcept;
 rgb8_t shadePixel(const fixedVector_t<rgb8_t> &points) noexcept;
-void shadeChunk(const area_t size, const area_t subchunk, const uint32_t subdiv,
-	stream_t &stream, const uint32_t affinityOffset) noexcept;
 
 #endif /*SHADE__HXX*/
@@ -0,0 +1,18 @@
+#include "shader.hxx"
+#include "escapeCodec.hxx"
+
+rgb8_t *image{nullptr};
+std::atomic<uint32_t> *imageStatus{nullptr};
+rowQueue_t completedRows;
+
+void shadeValues(const uint32_t *const values, const uint32_t width, fixedVector_t<rgb8_t> &points,
+	rgb8_t *const row) noexcept
+{
+	const uint32_t samples = points.count();
+	for (uint32_t x{0}; x < width; ++x)
+	{
+		for (uint32_t i{0}; i < samples; ++i)
+			points[i] = shade(dequantise(values[(x * samples) + i]));
+		row[x] = shadePixel(points);
+	}
+}
@@ -0,0 +1,64 @@
+#ifndef SHADER__HXX
+#define SHADER__HXX
+
+#include <stdint.h>
+#include <atomic>
+#include <mutex>
+#include <condition_variable>
+#include "mandelbrot.hxx"
+#include "shade.hxx"
+
+// Rows whose pixels have all arrived, queued for the image writer as they complete.
+struct rowQueue_t final
+{
+private:
+	fixedVector_t<uint32_t> rows;
+	uint32_t head, tail;
+	std::mutex queueMutex;
+	std::condition_variable queueCond;
+
+public:
+	rowQueue_t() noexcept : rows{}, head{0}, tail{0}, queueMutex{}, queueCond{} { }
+
+	// Each row completes once, so the queue never needs to hold more than the image's height.
+	bool reset(const uint32_t height) noexcept
+	{
+		rows = fixedVector_t<uint32_t>{height};
+		head = tail = 0;
+		return rows.valid();
+	}
+
+	void push(const uint32_t row) noexcept
+	{
+		std::lock_guard<std::mutex> lock(queueMutex);
+		rows.data()[tail++] = row;
+		queueCond.notify_one();
+	}
+
+	uint32_t pop() noexcept
+	{
+		std::unique_lock<std::mutex> lock(queueMutex);
+		queueCond.wait(lock, [&]() noexcept { return head != tail; });
+		return rows.data()[head++];
+	}
+
+	bool tryPop(uint32_t &row) noexcept
+	{
+		std::lock_guard<std::mutex> lock(queueMutex);
+		if (head == tail)
+			return false;
+		row = rows.data()[head++];
+		return true;
+	}
+};
+
+extern rgb8_t *image;
+extern std::atomic<uint32_t> *imageStatus;
+extern rowQueue_t completedRows;
+extern uint32_t xTiles;
+
+// Shades a row of escape values, one pixel per points.count() values, into row.
+void shadeValues(const uint32_t *const values, const uint32_t width, fixedVector_t<rgb8_t> &points,
+	rgb8_t *const row) noexcept;
+
+#endif /*SHADER__HXX*/
@@ -0,0 +1,269 @@
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/file.h>
+#include <sys/syscall.h>
+#include <linux/futex.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <limits.h>
+#include <errno.h>
+#include <stdio.h>
+#include <string.h>
+#include <algorithm>
+#include <new>
+#include <thread>
+#include "sharedImage.hxx"
+#include "memory.hxx"
+
+using namespace std::literals::chrono_literals;
+
+struct sharedImageHeader_t final
+{
+	std::atomic<uint32_t> ready;
+	uint32_t width, height;
+	uint32_t tileCount;
+	uint64_t maxIterations;
+};
+
+static_assert(sizeof(std::atomic<uint32_t>) == sizeof(uint32_t), "std::atomic<uint32_t> must be usable as a futex");
+constexpr static const char *const sharedImagePrefix = "/mandelbrot-";
+// Compute processes can start before the shader process has created the image, so they poll for
+// it at this interval - giving the shader process 10 seconds to show up before they give up.
+constexpr static const auto openInterval = 1ms;
+constexpr static const uint32_t openAttempts = 10000;
+
+constexpr size_t cacheRound(const size_t size) noexcept
+	{ return (size + 63) & ~size_t(63); }
+constexpr size_t statusOffset() noexcept
+	{ return cacheRound(sizeof(sharedImageHeader_t)); }
+size_t tilesOffset(const area_t size) noexcept
+	{ return statusOffset() + cacheRound(sizeof(std::atomic<uint32_t>) * size.height()); }
+size_t pixelsOffset(const area_t size, const uint32_t tileCount) noexcept
+	{ return tilesOffset(size) + cacheRound(sizeof(tile_t) * tileCount); }
+size_t sharedLength(const area_t size, const uint32_t tileCount) noexcept
+	{ return pixelsOffset(size, tileCount) + (sizeof(rgb8_t) * size.width() * size.height()); }
+
+bool validSession(const char *const session) noexcept
+{
+	const size_t length = strlen(session);
+	return length && length + strlen(sharedImagePrefix) < NAME_MAX && !strchr(session, '/');
+}
+
+// The name of the shared memory object holding the image for a session.
+std::unique_ptr<char []> sharedImageName(const char *const session) noexcept
+{
+	const size_t length = strlen(sharedImagePrefix) + strlen(session) + 1;
+	auto name = makeUnique<char []>(length);
+	if (name)
+		snprintf(name.get(), length, "%s%s", sharedImagePrefix, session);
+	return name;
+}
+
+inline void futexWait(std::atomic<uint32_t> &word, const uint32_t value, const std::chrono::nanoseconds timeout) noexcept
+{
+	const timespec time{0, long(timeout.count())};
+	syscall(SYS_futex, &word, FUTEX_WAIT, value, &time, nullptr, 0);
+}
+inline void futexWake(std::atomic<uint32_t> &word) noexcept
+	{ syscall(SYS_futex, &word, FUTEX_WAKE, INT_MAX, nullptr, nullptr, 0); }
+
+sharedImage_t::~sharedImage_t() noexcept
+{
+	if (!header)
+		return;
+	munmap(header, length);
+	if (fd != -1)
+	{
+		shm_unlink(name.get());
+		close(fd);
+	}
+}
+
+rgb8_t *sharedImage_t::pixels() const noexcept
+{
+	char *const base = reinterpret_cast<char *>(header);
+	return reinterpret_cast<rgb8_t *>(base + pixelsOffset({header->width, header->height}, header->tileCount));
+}
+
+std::atomic<uint32_t> *sharedImage_t::status() const noexcept
+{
+	char *const base = reinterpret_cast<char *>(header);
+	return reinterpret_cast<std::atomic<uint32_t> *>(base + statusOffset());
+}
+
+tile_t *sharedImage_t::tiles() const noexcept
+{
+	char *const base = reinterpret_cast<char *>(header);
+	return reinterpret_cast<tile_t *>(base + tilesOffset({header->width, header->height}));
+}
+
+// A shader process that died leaves its image behind, so check the creator is still around. It
+// holds an exclusive lock on the image that the kernel drops however it exits - unlike its PID,
+// which stays valid while it's a zombie and can be reused after.
+bool creatorAlive(const int fd) noexcept
+{
+	// Failing to take the lock for any other reason is no sign it's gone, so count that as alive too.
+	if (flock(fd, LOCK_SH | LOCK_NB))
+		return true;
+	flock(fd, LOCK_UN);
+	return false;
+}
+
+// Whether the image left under name was made by a shader process that has since died. Images not
+// yet sized are still being set up - the lock is taken first - so are never stale.
+bool staleImage(const char *const name) noexcept
+{
+	const int fd = shm_open(name, O_RDONLY, 0);
+	if (fd == -1)
+		return false;
+	struct stat info{};
+	const bool stale = !fstat(fd, &info) && size_t(info.st_size) >= sizeof(sharedImageHeader_t) &&
+		!creatorAlive(fd);
+	close(fd);
+	return stale;
+}
+
+sharedImage_t sharedImage_t::create(const char *const session, const area_t size, const uint32_t tileCount) noexcept
+{
+	const size_t length = sharedLength(size, tileCount);
+	auto name = sharedImageName(session);
+	if (!name)
+		return {};
+	int fd = shm_open(name.get(), O_RDWR | O_CREAT | O_EXCL, S_IRUSR | S_IWUSR);
+	// Clean up after a previous render of the session that did not exit cleanly - but leave
+	// the image of one that's still running alone.
+	if (fd == -1 && errno == EEXIST && staleImage(name.get()))
+	{
+		shm_unlink(name.get());
+		fd = shm_open(name.get(), O_RDWR | O_CREAT | O_EXCL, S_IRUSR | S_IWUSR);
+	}
+	if (fd == -1)
+		return {};
+	void *const memory = flock(fd, LOCK_EX | LOCK_NB) || ftruncate(fd, length) ? MAP_FAILED :
+		mmap(nullptr, length, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+	if (memory == MAP_FAILED)
+	{
+		shm_unlink(name.get());
+		close(fd);
+		return {};
+	}
+
+	auto header = new (memory) sharedImageHeader_t{};
+	header->width = size.width();
+	header->height = size.height();
+	header->tileCount = tileCount;
+	sharedImage_t image{header, length, fd, std::move(name)};
+	std::atomic<uint32_t> *const status = image.status();
+	for (uint32_t i{0}; i < size.height(); ++i)
+		new (&status[i]) std::atomic<uint32_t>{0};
+	return image;
+}
+
+void sharedImage_t::ready(const uint64_t maxIterations) const noexcept
+{
+	header->maxIterations = maxIterations;
+	header->ready = 1;
+	futexWake(header->ready);
+}
+
+uint64_t sharedImage_t::maxIterations() const noexcept
+	{ return header->maxIterations; }
+
+// Maps the shared image if it exists and has been sized, returning nullptr otherwise. fd is left
+// open on success so the creator's lock can be checked.
+sharedImageHeader_t *mapImage(const char *const name, const size_t length, int &fd) noexcept
+{
+	fd = shm_open(name, O_RDWR, 0);
+	if (fd == -1)
+		return nullptr;
+	struct stat info{};
+	void *const memory = fstat(fd, &info) || size_t(info.st_size) != length ? MAP_FAILED :
+		mmap(nullptr, length, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+	if (memory == MAP_FAILED)
+	{
+		close(fd);
+		return nullptr;
+	}
+	return static_cast<sharedImageHeader_t *>(memory);
+}
+
+sharedImage_t sharedImage_t::open(const char *const session, const area_t size, const uint32_t tileCount) noexcept
+{
+	const size_t length = sharedLength(size, tileCount);
+	auto name = sharedImageName(session);
+	if (!name)
+		return {};
+	sharedImageHeader_t *header = nullptr;
+	// Wait for the shader process to create the image and make it ready.
+	for (uint32_t attempt{0}; attempt < openAttempts; ++attempt)
+	{
+		int fd{-1};
+		header = mapImage(name.get(), length, fd);
+		if (header)
+		{
+			while (!header->ready && creatorAlive(fd))
+				futexWait(header->ready, 0, 1ms);
+			const bool alive = header->ready && creatorAlive(fd);
+			close(fd);
+			if (alive)
+				break;
+			munmap(header, length);
+			header = nullptr;
+		}
+		std::this_thread::sleep_for(openInterval);
+	}
+	if (!header)
+		return {};
+	else if (header->width != size.width() || header->height != size.height() || header->tileCount != tileCount)
+	{
+		munmap(header, length);
+		return {};
+	}
+	return {header, length, -1, std::move(name)};
+}
+
+void sharedImage_t::rowComplete(const uint32_t row) const noexcept
+{
+	std::atomic<uint32_t> &rowStatus = status()[row];
+	++rowStatus;
+	futexWake(rowStatus);
+}
+
+bool sharedImage_t::waitRow(const uint32_t row, const uint32_t count, const std::chrono::nanoseconds timeout) const noexcept
+{
+	std::atomic<uint32_t> &rowStatus = status()[row];
+	const uint32_t value = rowStatus;
+	if (value < count)
+		futexWait(rowStatus, value, timeout);
+	return rowStatus >= count;
+}
+
+bool sharedImageStream_t::read(void *const, const size_t, size_t &actualLen)
+{
+	actualLen = 0;
+	return false;
+}
+
+bool sharedImageStream_t::write(const void *const valuePtr, const size_t valueLen)
+{
+	const char *const value = static_cast<const char *>(valuePtr);
+	const size_t rowLength = sizeof(rgb8_t) * subchunk.width();
+	size_t written = 0;
+	while (written < valueLen)
+	{
+		if (row == subchunk.height())
+			return false;
+		const size_t amount = std::min(valueLen - written, rowLength - column);
+		const size_t pixel = ((offset.height() + row) * size_t(imageWidth)) + offset.width();
+		memcpy(reinterpret_cast<char *>(image.pixels() + pixel) + column, value + written, amount);
+		column += amount;
+		written += amount;
+		if (column == rowLength)
+		{
+			image.rowComplete(offset.height() + row);
+			column = 0;
+			++row;
+		}
+	}
+	return true;
+}
@@ -0,0 +1,87 @@
+#ifndef SHARED_IMAGE__HXX
+#define SHARED_IMAGE__HXX
+
+#include <stdint.h>
+#include <atomic>
+#include <memory>
+#include <chrono>
+#include "mandelbrot.hxx"
+#include "shade.hxx"
+#include "stream.hxx"
+
+struct sharedImageHeader_t;
+
+// The image and its row status, mapped into every process of a single host render so that
+// compute processes write their pixels straight into the shader process's image.
+struct sharedImage_t final
+{
+private:
+	sharedImageHeader_t *header;
+	size_t length;
+	// The shader process keeps the image open, holding a lock on it for as long as it's running.
+	int fd;
+	std::unique_ptr<char []> name;
+
+	sharedImage_t(sharedImageHeader_t *const _header, const size_t _length, const int _fd,
+		std::unique_ptr<char []> &&_name) noexcept : header{_header}, length{_length}, fd{_fd},
+		name{std::move(_name)} { }
+
+public:
+	sharedImage_t() noexcept : header{nullptr}, length{0}, fd{-1}, name{} { }
+	sharedImage_t(const sharedImage_t &) = delete;
+	sharedImage_t(sharedImage_t &&image) noexcept : sharedImage_t{} { swap(image); }
+	~sharedImage_t() noexcept;
+	sharedImage_t &operator =(const sharedImage_t &) = delete;
+	sharedImage_t &operator =(sharedImage_t &&image) noexcept { swap(image); return *this; }
+
+	// create() is for the shader process, open() is for the compute processes and waits for ready().
+	// Every process of a render names the same session, so renders on a host with different
+	// sessions each get their own image.
+	static sharedImage_t create(const char *const session, const area_t size, const uint32_t tileCount) noexcept;
+	static sharedImage_t open(const char *const session, const area_t size, const uint32_t tileCount) noexcept;
+	// Every tile is rendered with the shader process's iteration limit.
+	void ready(const uint64_t maxIterations) const noexcept;
+	uint64_t maxIterations() const noexcept;
+
+	bool valid() const noexcept { return header; }
+	rgb8_t *pixels() const noexcept;
+	std::atomic<uint32_t> *status() const noexcept;
+	// The tile each compute process works on, filled in by the shader process before ready().
+	tile_t *tiles() const noexcept;
+	void rowComplete(const uint32_t row) const noexcept;
+	// Waits up to timeout for row to be completed count times, returning whether it has been.
+	bool waitRow(const uint32_t row, const uint32_t count, const std::chrono::nanoseconds timeout) const noexcept;
+
+	void swap(sharedImage_t &image) noexcept
+	{
+		std::swap(header, image.header);
+		std::swap(length, image.length);
+		std::swap(fd, image.fd);
+		std::swap(name, image.name);
+	}
+};
+
+// Write-only stream that places the pixels of a subchunk directly into a shared image.
+struct sharedImageStream_t final : public stream_t
+{
+private:
+	const sharedImage_t &image;
+	const uint32_t imageWidth;
+	const area_t subchunk;
+	const area_t offset;
+	uint32_t row;
+	size_t column;
+
+public:
+	sharedImageStream_t(const sharedImage_t &_image, const uint32_t _imageWidth, const area_t _subchunk,
+		const area_t _offset) noexcept : image{_image}, imageWidth{_imageWidth}, subchunk{_subchunk},
+		offset{_offset}, row{0}, column{0} { }
+
+	bool read(void *const value, const size_t valueLen, size_t &actualLen) final override;
+	bool write(const void *const value, const size_t valueLen) final override;
+};
+
+// Whether session can name a shared image - it must be non-empty and free of slashes.
+bool validSession(const char *const session) noexcept;
+
+#endif /*SHARED_IMAGE__HXX*/
@@ -3,6 +3,7 @@
 #include <arpa/inet.h>
 #include <netinet/in.h>
 #include <memory.h>
+#include <fcntl.h>
 
 #include "socket.hxx"
 #include "memory.hxx"
@@ -85,6 +86,14 @@ char socket_t::peek() const noexcept
 	return buffer;
 }
 
+bool socket_t::blocking(const bool block) const noexcept
+{
+	const int flags = fcntl(socket, F_GETFL);
+	if (flags == -1)
+		return false;
+	return fcntl(socket, F_SETFL, block ? flags & ~O_NONBLOCK : flags | O_NONBLOCK) == 0;
+}
+
 int typeToFamily(const socketType_t type) noexcept
 {
 	if (type == socketType_t::ipv4)
@@ -153,7 +162,7 @@ bool socketStream_t::listen(const char *const where, const uint16_t port) noexce
 		return false;
 	else if (family == socketType_t::dontCare)
 		sock = socket_t(service.ss_family, SOCK_STREAM, IPPROTO_TCP);
-	return sock.bind(service) && sock.listen(1);
+	return sock.bind(service) && sock.listen(SOMAXCONN);
 }
 
 socketStream_t socketStream_t::accept() const noexcept
@@ -39,6 +39,7 @@ public:
 		{ return connect(static_cast<const void *>(&addr), sizeof(T)); }
 	bool connect(const sockaddr_storage &addr) const noexcept;
 	bool listen(const int32_t queueLength) const noexcept;
+	bool blocking(const bool block) const noexcept;
 	socket_t accept(sockaddr *peerAddr = nullptr, socklen_t *peerAddrLen = nullptr) const noexcept;
 	ssize_t write(const void *const bufferPtr, const size_t len) const noexcept;
 	ssize_t read(void *const bufferPtr, const size_t len) const noexcept;
@@ -81,6 +82,7 @@ public:
 	bool connect(const char *const where, uint16_t port) noexcept;
 	bool listen(const char *const where, uint16_t port) noexcept;
 	socketStream_t accept() const noexcept;
+	const socket_t &socket() const noexcept { return sock; }
 
 	bool read(void *const value, const size_t valueLen, size_t &actualLen) final override;
 	bool write(const void *const value, const size_t valueLen) final override;